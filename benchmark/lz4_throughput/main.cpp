@@ -0,0 +1,103 @@
+/*
+ * Compression throughput of the built-in LZ4 frame writer on log-like data.
+ *
+ * usage: mal-benchmark-lz4-throughput [megabytes]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <mal_log/util/lz4_frame.hpp>
+#include <mal_log/util/chrono.hpp>
+#include <mal_log/util/mem_printf.hpp>
+
+using namespace mal;
+
+//------------------------------------------------------------------------------
+struct counting_sink {                                                          //discards, counts
+    counting_sink() : count (0) {}
+    void write (const void*, uword sz)
+    {
+        count += sz;
+    }
+    u64 count;
+};
+//------------------------------------------------------------------------------
+static std::string make_log_text (uword bytes)
+{
+    static const char* fmts[] = {
+        "%011llu.%09llu [err_] message %llu, float = %f, hex = 0x%08llx\n",
+        "%011llu.%09llu [warn] connection %llu from 10.0.%llu.%llu dropped\n",
+        "%011llu.%09llu [note] request id=%llu took %llu us, status=%llu\n",
+    };
+    std::string s;
+    s.reserve (bytes + 256);
+    u64 ns = 1234567;
+    for (u64 i = 0; s.size() < bytes; ++i) {
+        char line[256];
+        ns += 1000 + (i * 7919) % 50000;
+        int len = 0;
+        switch (i % 3) {
+        case 0:
+            len = mem_printf(
+                line, sizeof line, fmts[0], ns / 1000000000, ns % 1000000000,
+                i, (double) i * 1.37, i * 2654435761ULL
+                );
+            break;
+        case 1:
+            len = mem_printf(
+                line, sizeof line, fmts[1], ns / 1000000000, ns % 1000000000,
+                i % 1000, (i >> 3) % 256, i % 256
+                );
+            break;
+        default:
+            len = mem_printf(
+                line, sizeof line, fmts[2], ns / 1000000000, ns % 1000000000,
+                i, (i * 31) % 10000, (i % 17) ? 200ULL : 500ULL
+                );
+            break;
+        }
+        s.append (line, len > 0 ? len : 0);
+    }
+    return s;
+}
+//------------------------------------------------------------------------------
+static double run (const std::string& text, uword write_size, u64& out_bytes)
+{
+    counting_sink    o;
+    lz4_frame_writer w;
+    w.init();
+
+    auto start = ch::steady_clock::now();
+    w.begin (o);
+    for (uword i = 0; i < text.size(); i += write_size) {
+        uword sz = (text.size() - i) < write_size ? text.size() - i : write_size;
+        w.write (o, text.data() + i, sz);
+    }
+    w.end (o);
+    auto end = ch::steady_clock::now();
+
+    out_bytes = o.count;
+    return ch::duration_cast<ch::duration<double> >(end - start).count();
+}
+//------------------------------------------------------------------------------
+int main (int argc, char* argv[])
+{
+    uword mb = (argc > 1) ? (uword) atoi (argv[1]) : 256;
+    std::string text = make_log_text (mb * 1024 * 1024);
+
+    static const uword write_sizes[] = { 80, 4096, 64 * 1024 };
+    for (uword i = 0; i < sizeof write_sizes / sizeof write_sizes[0]; ++i) {
+        u64 out;
+        double secs = run (text, write_sizes[i], out);
+        printf(
+            "writes of %6u bytes: %8.1f MB/s, ratio %.2f (%llu -> %llu)\n",
+            (unsigned) write_sizes[i],
+            ((double) text.size() / (1024 * 1024)) / secs,
+            (double) text.size() / out,
+            (unsigned long long) text.size(),
+            (unsigned long long) out
+            );
+    }
+    return 0;
+}
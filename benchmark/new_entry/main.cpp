@@ -0,0 +1,250 @@
+/*
+ * Producer side cost of a log call with 0, 3 and 6 arguments: time and ticks
+ * per call and the stack touched by one call. The logger is pumped manually
+ * and its queue fits a whole run, so the consumer never runs while measuring.
+ *
+ * Code size: this file also holds "code_size_sites", 42 call sites of arity
+ * 0-6 with mixed types. Compare "size" of this benchmark's "main.cpp.o" (under
+ * "build/linux/build") between the two trees being compared. The stack figure
+ * can be cross-checked by building with "-fstack-usage".
+ *
+ * usage: mal-benchmark-new-entry [out folder] [calls per run]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <mal_log/mal_log.hpp>
+#include <mal_log/frontend.hpp>
+#include <mal_log/timestamp.hpp>
+#include <mal_log/util/chrono.hpp>
+
+#if defined (_MSC_VER)
+    #define BENCH_NOINLINE __declspec (noinline)
+#else
+    #define BENCH_NOINLINE __attribute__ ((noinline))
+#endif
+
+using namespace mal;
+
+//------------------------------------------------------------------------------
+mal::frontend& get_mal_logger_instance()
+{
+    static mal::frontend fe;
+    return fe;
+}
+//------------------------------------------------------------------------------
+BENCH_NOINLINE void call0 (int)
+{
+    log_error ("zero");
+}
+//------------------------------------------------------------------------------
+BENCH_NOINLINE void call3 (int i)
+{
+    log_error ("three {} {} {}", i, 1.5, lit ("x"));
+}
+//------------------------------------------------------------------------------
+BENCH_NOINLINE void call6 (int i)
+{
+    log_error(
+        "six {} {} {} {} {} {}",
+        i, (u64) i << 20, 2.5f, (i16) -i, i > 3, lit ("y")
+        );
+}
+//------------------------------------------------------------------------------
+BENCH_NOINLINE void code_size_sites (int i)
+{
+    for (int s = 0; s < 6; ++s) {                                               //one group per type mix
+        switch (s) {
+        case 0:
+            log_error ("a0");
+            log_error ("a1 {}", (i16) -i);
+            log_error ("a2 {} {}", (u8) i, i > 3);
+            log_error ("a3 {} {} {}", (i64) i, lit ("s"), i * 0.5);
+            log_error ("a4 {} {} {} {}", (u32) i, (float) i, (u8) i, (u8) i);
+            log_error(
+                "a5 {} {} {} {} {}", (u64) i, (u8) i, lit ("s"), (i64) i, i
+                );
+            log_error(
+                "a6 {} {} {} {} {} {}",
+                i > 3, i * 0.5, (u8) i, lit ("s"), (u64) i << 20, (i16) -i
+                );
+            break;
+        case 1:
+            log_error ("b0");
+            log_error ("b1 {}", i * 0.5);
+            log_error ("b2 {} {}", (float) i, i > 3);
+            log_error ("b3 {} {} {}", (u64) i << 20, (u32) i, (u64) i);
+            log_error ("b4 {} {} {} {}", (i64) i, (float) i, (i64) i, i);
+            log_error(
+                "b5 {} {} {} {} {}",
+                (float) i, (i16) -i, i > 3, (u64) i << 20, (i16) -i
+                );
+            log_error(
+                "b6 {} {} {} {} {} {}",
+                (u32) i, (u64) i << 20, lit ("s"), (float) i, i > 3, (u8) i
+                );
+            break;
+        case 2:
+            log_error ("c0");
+            log_error ("c1 {}", lit ("s"));
+            log_error ("c2 {} {}", (u64) i << 20, (u8) i);
+            log_error ("c3 {} {} {}", (u8) i, i * 0.5, lit ("s"));
+            log_error ("c4 {} {} {} {}", (i16) -i, (u32) i, i > 3, (u64) i);
+            log_error(
+                "c5 {} {} {} {} {}",
+                (u32) i, (u32) i, (u64) i << 20, (i64) i, (u8) i
+                );
+            log_error(
+                "c6 {} {} {} {} {} {}",
+                (i64) i, (u32) i, (u64) i << 20, (u32) i, (i16) -i, (u64) i
+                );
+            break;
+        case 3:
+            log_error ("d0");
+            log_error ("d1 {}", (u64) i << 20);
+            log_error ("d2 {} {}", (i16) -i, (u32) i);
+            log_error ("d3 {} {} {}", (float) i, lit ("s"), (float) i);
+            log_error ("d4 {} {} {} {}", (u64) i, (float) i, i > 3, (u8) i);
+            log_error(
+                "d5 {} {} {} {} {}",
+                i * 0.5, (u8) i, (i16) -i, (i16) -i, (u8) i
+                );
+            log_error(
+                "d6 {} {} {} {} {} {}",
+                i * 0.5, (i64) i, i * 0.5, (i16) -i, (u32) i, (float) i
+                );
+            break;
+        case 4:
+            log_error ("e0");
+            log_error ("e1 {}", i > 3);
+            log_error ("e2 {} {}", lit ("s"), lit ("s"));
+            log_error ("e3 {} {} {}", (i16) -i, (float) i, (u8) i);
+            log_error ("e4 {} {} {} {}", (u64) i, (i64) i, (u64) i, lit ("s"));
+            log_error(
+                "e5 {} {} {} {} {}",
+                (u8) i, (u64) i << 20, (i64) i, i > 3, i > 3
+                );
+            log_error(
+                "e6 {} {} {} {} {} {}",
+                (u64) i, lit ("s"), (u8) i, i > 3, (i64) i, lit ("s")
+                );
+            break;
+        default:
+            log_error ("f0");
+            log_error ("f1 {}", (u32) i);
+            log_error ("f2 {} {}", i * 0.5, (i64) i);
+            log_error ("f3 {} {} {}", i > 3, i > 3, (u8) i);
+            log_error ("f4 {} {} {} {}", lit ("s"), (u8) i, (i16) -i, i);
+            log_error(
+                "f5 {} {} {} {} {}",
+                (float) i, (u64) i << 20, lit ("s"), (u64) i, (i64) i
+                );
+            log_error(
+                "f6 {} {} {} {} {} {}",
+                (i64) i, (u64) i << 20, (u64) i, (i64) i, lit ("s"), (u64) i
+                );
+            break;
+        }
+    }
+}
+//------------------------------------------------------------------------------
+static const uword paint_bytes = 16 * 1024;
+static const u8    paint       = 0xa5;
+//------------------------------------------------------------------------------
+BENCH_NOINLINE void paint_stack()                                               //fills the stack area the next call will use
+{
+    volatile u8 area[paint_bytes];
+    for (uword i = 0; i < paint_bytes; ++i) {
+        area[i] = paint;
+    }
+}
+//------------------------------------------------------------------------------
+BENCH_NOINLINE uword painted_stack_used()                                       //the same area, called from the same frame
+{
+    volatile u8 area[paint_bytes];
+    uword i = 0;
+    while (i < paint_bytes && area[i] == paint) {
+        ++i;
+    }
+    return paint_bytes - i;
+}
+//------------------------------------------------------------------------------
+struct result {
+    double ns;
+    double ticks;
+    uword  stack;
+};
+//------------------------------------------------------------------------------
+static result run (void (*f) (int), uword calls, uword runs)
+{
+    frontend& fe = get_mal_logger_instance();
+    result r;
+    r.ns    = 1e12;
+    r.ticks = 1e12;
+    for (uword run = 0; run < runs; ++run) {                                    //best of
+        auto start = ch::steady_clock::now();
+        u64  t0    = get_tsc_timestamp();
+        for (uword i = 0; i < calls; ++i) {
+            f ((int) i);
+        }
+        u64  t1  = get_tsc_timestamp();
+        auto end = ch::steady_clock::now();
+        while (fe.pump()) {}
+        double ns = (double) ch::duration_cast<ch::nanoseconds>(
+            end - start
+            ).count();
+        r.ns    = (ns / calls < r.ns) ? ns / calls : r.ns;
+        r.ticks = ((double) (t1 - t0) / calls < r.ticks) ?
+            (double) (t1 - t0) / calls : r.ticks;
+    }
+    paint_stack();
+    f (1);
+    r.stack = painted_stack_used();
+    while (fe.pump()) {}
+    return r;
+}
+//------------------------------------------------------------------------------
+int main (int argc, char* argv[])
+{
+    std::string folder = (argc > 1) ? argv[1] : "./";
+    uword       calls  = (argc > 2) ? (uword) atoi (argv[2]) : 200000;
+    if (folder.empty() || folder[folder.size() - 1] != '/') {
+        folder += '/';
+    }
+    uword slots = 1;
+    while (slots < calls + 1024) {                                              //a whole run fits
+        slots *= 2;
+    }
+    frontend& fe = get_mal_logger_instance();
+    auto c                         = fe.get_cfg();
+    c.file.out_folder              = folder;
+    c.file.name_prefix             = "new_entry_bench.";
+    c.file.aprox_size              = 16 * 1024 * 1024;
+    c.file.rotation.file_count     = 2;                                         //bounded disk use
+    c.misc.manual_pump             = true;
+    c.queue.can_use_heap_q         = false;
+    c.queue.bounded_q_entry_size   = 64;
+    c.queue.bounded_q_block_size   = 64 * slots;
+    if (fe.init_backend (c) != frontend::init_ok) {
+        fprintf (stderr, "unable to initialize the logger\n");
+        return 1;
+    }
+    fe.set_console_severity (sev::off);
+
+    code_size_sites (1);
+    while (fe.pump()) {}
+
+    static void (*fns[]) (int)       = { call0, call3, call6 };
+    static const unsigned arities[] = { 0, 3, 6 };
+    printf ("%5s %10s %12s %12s\n", "args", "ns/call", "ticks/call", "stack");
+    for (uword i = 0; i < sizeof fns / sizeof fns[0]; ++i) {
+        result r = run (fns[i], calls, 25);
+        printf(
+            "%5u %8.1fns %12.1f %10u B\n",
+            arities[i], r.ns, r.ticks, (unsigned) r.stack
+            );
+    }
+    fe.on_termination();
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * NUL and placeholder scanning kernels against the byte loops they replaced,
+ * on strings with the lengths seen on format strings and "lit" parameters.
+ *
+ * usage: mal-benchmark-string-scan [iterations]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <mal_log/util/string_scan.hpp>
+#include <mal_log/util/chrono.hpp>
+
+using namespace mal;
+
+//------------------------------------------------------------------------------
+static std::vector<std::string> make_strings (uword len, uword count)
+{
+    static const char words[] =
+        "message connection request took from status dropped id value "
+        "retry socket timeout buffer queue file slice {} ";
+    std::vector<std::string> v;
+    for (uword i = 0; i < count; ++i) {
+        std::string s;
+        for (uword j = 0; s.size() < len; ++j) {
+            s.push_back (words[(i * 7 + j) % (sizeof words - 1)]);
+        }
+        v.push_back (s);
+    }
+    return v;
+}
+//------------------------------------------------------------------------------
+static uword bytewise_len (const char* s, uword max)                            //the old render_buffer loop
+{
+    uword i = 0;
+    for (; s[i] != 0; ++i) {
+        if (i == max) { break; }
+    }
+    return i;
+}
+//------------------------------------------------------------------------------
+static uword scan_placeholders_strchr (const char* s)
+{
+    uword count = 0;
+    while ((s = std::strchr (s, '{')) != nullptr) {
+        ++count;
+        ++s;
+    }
+    return count;
+}
+//------------------------------------------------------------------------------
+static uword scan_placeholders_mal (const char* s)
+{
+    uword count = 0;
+    while (*(s = find_chr_or_nul (s, '{')) != 0) {
+        ++count;
+        ++s;
+    }
+    return count;
+}
+//------------------------------------------------------------------------------
+template <class fn>
+static double ns_per_call(
+    const std::vector<std::string>& strs, uword iterations, fn f, uword& sink
+    )
+{
+    auto start = ch::steady_clock::now();
+    for (uword it = 0; it < iterations; ++it) {
+        for (uword i = 0; i < strs.size(); ++i) {
+            sink += f (strs[i].c_str());
+        }
+    }
+    auto end = ch::steady_clock::now();
+    double ns = (double) ch::duration_cast<ch::nanoseconds> (end - start).count();
+    return ns / (double) (iterations * strs.size());
+}
+//------------------------------------------------------------------------------
+int main (int argc, char* argv[])
+{
+    static const uword max_str = 2048;
+    uword iterations = (argc > 1) ? (uword) atoi (argv[1]) : 20000;
+    uword sink       = 0;
+
+    static const uword lengths[] = { 12, 40, 80, 160, 400, 1500 };
+    printf(
+        "%6s %10s %10s %10s %10s %10s\n",
+        "len", "bytewise", "strnlen", "find_nul", "strchr", "find_chr"
+        );
+    for (uword l = 0; l < sizeof lengths / sizeof lengths[0]; ++l) {
+        std::vector<std::string> strs = make_strings (lengths[l], 64);
+        double bw = ns_per_call (strs, iterations, [](const char* s) {
+            return bytewise_len (s, max_str);
+        }, sink);
+        double sl = ns_per_call (strs, iterations, [](const char* s) {
+            return (uword) strnlen (s, max_str + 1);
+        }, sink);
+        double fn = ns_per_call (strs, iterations, [](const char* s) {
+            return find_nul (s, max_str + 1);
+        }, sink);
+        double sc = ns_per_call (strs, iterations, [](const char* s) {
+            return scan_placeholders_strchr (s);
+        }, sink);
+        double fc = ns_per_call (strs, iterations, [](const char* s) {
+            return scan_placeholders_mal (s);
+        }, sink);
+        printf(
+            "%6u %8.1fns %8.1fns %8.1fns %8.1fns %8.1fns\n",
+            (unsigned) lengths[l], bw, sl, fn, sc, fc
+            );
+    }
+    return sink == 0 ? 1 : 0;
+}
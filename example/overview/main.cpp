@@ -120,6 +120,12 @@ void general_features()
         bytes (deep_copied_bytes, sizeof deep_copied_bytes)
         );
     ++i;
+    log_error(
+        "message {}, deeply copied bytes as base64 = {b}",
+        i,
+        bytes (deep_copied_bytes, sizeof deep_copied_bytes)
+        );
+    ++i;
     log_error(
         "message {}, 1={}, 2={}, 3={}, 4={}, 5={x}",
         i,
@@ -0,0 +1,278 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_ASYNC_SINK_HPP_
+#define MAL_LOG_ASYNC_SINK_HPP_
+
+#include <cassert>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/atomic.hpp>
+#include <mal_log/util/thread.hpp>
+#include <mal_log/util/thread_setup.hpp>
+#include <mal_log/sink.hpp>
+
+namespace mal {
+
+//------------------------------------------------------------------------------
+/* Sink adapter that copies the batches to a bounded queue and writes them to
+   "target" from its own thread, so a slow destination doesn't stall the logger
+   (and the other sinks). Register the adapter instead of the target and set
+   the severity on the adapter. Until "init" succeeds the writes are forwarded
+   to the target directly.
+*/
+//------------------------------------------------------------------------------
+class async_sink : public sink
+{
+public:
+    //--------------------------------------------------------------------------
+    async_sink (const std::shared_ptr<sink>& target) :
+        sink (target->severity()),
+        m_target (target)
+    {
+        m_overflow   = sink_overflow::drop;
+        m_dropped    = 0;
+        m_unreported = 0;
+        m_flush      = false;
+        m_stop       = false;
+        m_active     = false;
+        thread_cfg_set_defaults (m_thread_cfg);
+    }
+    //--------------------------------------------------------------------------
+    ~async_sink()
+    {
+        stop();
+    }
+    //--------------------------------------------------------------------------
+    bool init (const sink_queue_cfg& c)
+    {
+        assert (c.buffer_count);
+        assert (!m_active);
+        m_overflow   = c.overflow;
+        m_thread_cfg = c.thread;
+        m_stop       = false;
+        try {
+            m_buffers.resize (c.buffer_count);
+            for (uword i = 0; i < m_buffers.size(); ++i) {
+                m_free.push_back (&m_buffers[i]);
+            }
+            m_thread = th::thread ([this]() { this->thread(); });
+        }
+        catch (...) {
+            m_free.clear();
+            m_buffers.clear();
+            return false;
+        }
+        m_active = true;
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    virtual void write (const sink_span* spans, uword count)
+    {
+        if (!m_active) {
+            m_target->write (spans, count);
+            return;
+        }
+        buffer* b;
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            if (m_free.empty() && m_overflow == sink_overflow::drop) {
+                lock.unlock();
+                uword entries = 0;
+                for (uword i = 0; i < count; ++i) {
+                    entries += spans[i].entries;
+                }
+                m_dropped    = m_dropped + entries;
+                m_unreported += entries;
+                return;
+            }
+            m_free_cond.wait (lock, [this]() { return !m_free.empty(); });
+            b = m_free.back();
+            m_free.pop_back();
+        }
+        fill (*b, spans, count);
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            m_pending.push_back (b);
+        }
+        m_pending_cond.notify_one();
+    }
+    //--------------------------------------------------------------------------
+    virtual void flush()                                                        //asynchronous
+    {
+        if (!m_active) {
+            m_target->flush();
+            return;
+        }
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            m_flush = true;
+        }
+        m_pending_cond.notify_one();
+    }
+    //--------------------------------------------------------------------------
+    virtual void close()                                                        //writes the queued batches before returning
+    {
+        stop();
+        m_target->close();
+    }
+    //--------------------------------------------------------------------------
+    virtual bool split_by_severity() const
+    {
+        return m_target->split_by_severity();
+    }
+    //--------------------------------------------------------------------------
+    uword dropped() const                                                       //entries
+    {
+        return m_dropped;
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    struct buffer {
+        std::vector<char>      bytes;
+        std::vector<sink_span> spans;
+    };
+    //--------------------------------------------------------------------------
+    void stop()
+    {
+        if (!m_active) {
+            return;
+        }
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            m_stop = true;
+        }
+        m_pending_cond.notify_one();
+        m_thread.join();
+        m_free.clear();
+        m_pending.clear();
+        m_buffers.clear();
+        m_active = false;
+    }
+    //--------------------------------------------------------------------------
+    void fill (buffer& b, const sink_span* spans, uword count)
+    {
+        b.bytes.clear();
+        b.spans.clear();
+        if (m_unreported) {
+            static const char msg[]  = "[logger err]->sink queue full, ";
+            static const char msg2[] = " entries dropped\n";
+            char  digits[24];
+            uword d = sizeof digits;
+            for (uword v = m_unreported; v || d == sizeof digits; v /= 10) {
+                digits[--d] = (char) ('0' + (v % 10));
+            }
+            b.bytes.insert (b.bytes.end(), msg, msg + sizeof msg - 1);
+            b.bytes.insert (b.bytes.end(), digits + d, digits + sizeof digits);
+            b.bytes.insert (b.bytes.end(), msg2, msg2 + sizeof msg2 - 1);
+            sink_span s;
+            s.data    = nullptr;
+            s.size    = b.bytes.size();
+            s.entries = 1;
+            s.min_sev = sev::error;
+            s.max_sev = sev::error;
+            s.flush   = false;
+            b.spans.push_back (s);
+            m_unreported = 0;
+        }
+        for (uword i = 0; i < count; ++i) {
+            const char* d = spans[i].data;
+            b.bytes.insert (b.bytes.end(), d, d + spans[i].size);
+            b.spans.push_back (spans[i]);
+        }
+        const char* data = b.bytes.data();                                      //rebasing once the vector no longer grows
+        for (uword i = 0; i < b.spans.size(); ++i) {
+            b.spans[i].data  = data;
+            data            += b.spans[i].size;
+        }
+    }
+    //--------------------------------------------------------------------------
+    void thread()
+    {
+        setup_this_thread (m_thread_cfg);
+        th::unique_lock<th::mutex> lock (m_lock);
+        while (true) {
+            m_pending_cond.wait (lock, [this]() {
+                return m_stop || m_flush || !m_pending.empty();
+            });
+            if (!m_pending.empty()) {
+                buffer* b = m_pending.front();
+                m_pending.pop_front();
+                lock.unlock();
+                if (!b->spans.empty()) {
+                    m_target->write (&b->spans[0], b->spans.size());
+                }
+                lock.lock();
+                m_free.push_back (b);
+                m_free_cond.notify_one();
+                continue;
+            }
+            if (m_flush) {
+                m_flush = false;
+                lock.unlock();
+                m_target->flush();
+                lock.lock();
+                continue;
+            }
+            if (m_stop) {
+                return;
+            }
+        }
+    }
+    //--------------------------------------------------------------------------
+    std::shared_ptr<sink>    m_target;
+    std::vector<buffer>      m_buffers;
+    std::vector<buffer*>     m_free;
+    std::deque<buffer*>      m_pending;
+    th::mutex                m_lock;
+    th::condition_variable   m_free_cond;
+    th::condition_variable   m_pending_cond;
+    th::thread               m_thread;
+    thread_cfg               m_thread_cfg;
+    mo_relaxed_atomic<uword> m_dropped;
+    uword                    m_unreported;
+    sink_overflow::policy    m_overflow;
+    bool                     m_flush;
+    bool                     m_stop;
+    bool                     m_active;
+};
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_ASYNC_SINK_HPP_ */
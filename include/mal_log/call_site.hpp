@@ -0,0 +1,292 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_CALL_SITE_HPP_
+#define MAL_LOG_CALL_SITE_HPP_
+
+#include <cassert>
+#include <string>
+#include <vector>
+#include <mal_log/util/system.hpp>
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/atomic.hpp>
+#include <mal_log/util/thread.hpp>
+#include <mal_log/frontend_types.hpp>
+
+namespace mal {
+
+//------------------------------------------------------------------------------
+/* The static descriptor of one log macro expansion. Created by the log macros
+   when "MAL_CALL_SITE_REGISTRY" is defined (see "mal_private.hpp"). It's added
+   to the registry the first time its line runs. After that the enable check
+   is a relaxed load and a compare, done before the severity check.
+*/
+//------------------------------------------------------------------------------
+class call_site
+{
+public:
+    //--------------------------------------------------------------------------
+    MAL_CONSTEXPR call_site(
+        const char* fmt, const char* file, unsigned line, sev::severity s
+        ) :
+        m_fmt   (fmt),
+        m_file  (file),
+        m_line  (line),
+        m_sev   (s),
+        m_state (unregistered),
+        m_next  (nullptr)
+    {}
+    //--------------------------------------------------------------------------
+    bool enabled()
+    {
+        uword s = m_state.load (mo_relaxed);
+        return (s == on) || (s == unregistered && register_site());
+    }
+    //--------------------------------------------------------------------------
+    bool is_enabled() const        { return m_state.load (mo_relaxed) != off; }
+    const char* fmt() const        { return m_fmt; }
+    const char* file() const       { return m_file; }
+    unsigned line() const          { return m_line; }
+    sev::severity severity() const { return m_sev; }
+    //--------------------------------------------------------------------------
+private:
+    friend class call_site_registry;
+
+    enum state { unregistered, on, off };
+
+    call_site (const call_site&);
+    call_site& operator= (const call_site&);
+
+    bool register_site();                                                       //defined after the registry
+
+    const char*         m_fmt;
+    const char*         m_file;
+    unsigned            m_line;
+    sev::severity       m_sev;
+    at::atomic<uword>   m_state;
+    call_site*          m_next;                                                 //written once, under the registry lock
+};
+//------------------------------------------------------------------------------
+/* Keeps the registered call sites and the enable/disable rules. The rules are
+   kept, so they apply to the lines that didn't run yet too. The last matching
+   rule wins, a call site that matches no rule is enabled.
+
+   Patterns can have "*" (any sequence) and "?" (any character) wildcards.
+   A pattern matches a call site if it matches either its "file:line" or its
+   format string, e.g. "*net/socket.cpp:*", "*main.cpp:120" or "*retrying*".
+*/
+//------------------------------------------------------------------------------
+class call_site_registry
+{
+public:
+    //--------------------------------------------------------------------------
+    static call_site_registry& get()
+    {
+        static call_site_registry* r = new call_site_registry();                //never deleted: log calls can run on static destructors
+        return *r;
+    }
+    //--------------------------------------------------------------------------
+    // Adds a rule. Returns the number of already registered call sites that
+    // it matched.
+    uword set_enabled (const char* pattern, bool enabled)
+    {
+        if (!pattern) {
+            assert (false);
+            return 0;
+        }
+        th::lock_guard<th::mutex> lock (m_mutex);
+        for (auto it = m_rules.begin(); it != m_rules.end(); ++it) {
+            if (it->pattern == pattern) {
+                m_rules.erase (it);
+                break;
+            }
+        }
+        rule r;
+        r.pattern = pattern;
+        r.enabled = enabled;
+        m_rules.push_back (r);
+
+        uword matches = 0;
+        for (call_site* s = m_head; s; s = s->m_next) {
+            if (site_matches (*s, pattern)) {
+                set_state (*s, enabled);
+                ++matches;
+            }
+        }
+        return matches;
+    }
+    //--------------------------------------------------------------------------
+    // Removes all the rules and enables all the call sites
+    void reset()
+    {
+        th::lock_guard<th::mutex> lock (m_mutex);
+        m_rules.clear();
+        for (call_site* s = m_head; s; s = s->m_next) {
+            set_state (*s, true);
+        }
+    }
+    //--------------------------------------------------------------------------
+    // Calls "f (const call_site&)" on the registered call sites matching the
+    // pattern (all if null). Don't log from "f". Returns the match count.
+    template <class F>
+    uword for_each (const char* pattern, F f)
+    {
+        th::lock_guard<th::mutex> lock (m_mutex);
+        uword matches = 0;
+        for (const call_site* s = m_head; s; s = s->m_next) {
+            if (!pattern || site_matches (*s, pattern)) {
+                f (*s);
+                ++matches;
+            }
+        }
+        return matches;
+    }
+    //--------------------------------------------------------------------------
+    bool add (call_site& s)
+    {
+        th::lock_guard<th::mutex> lock (m_mutex);
+        if (s.m_state.load (mo_relaxed) != call_site::unregistered) {
+            return s.is_enabled();                                              //another thread was first
+        }
+        bool enabled = true;
+        for (auto it = m_rules.begin(); it != m_rules.end(); ++it) {
+            if (site_matches (s, it->pattern.c_str())) {
+                enabled = it->enabled;
+            }
+        }
+        s.m_next = m_head;
+        m_head   = &s;
+        set_state (s, enabled);
+        return enabled;
+    }
+    //--------------------------------------------------------------------------
+    static bool wildcard_match (const char* pattern, const char* str)
+    {
+        const char* star  = nullptr;
+        const char* retry = nullptr;
+        while (*str) {
+            if (*pattern == '*') {
+                star  = ++pattern;
+                retry = str;
+            }
+            else if (*pattern == '?' || *pattern == *str) {
+                ++pattern;
+                ++str;
+            }
+            else if (star) {
+                pattern = star;
+                str     = ++retry;
+            }
+            else {
+                return false;
+            }
+        }
+        while (*pattern == '*') {
+            ++pattern;
+        }
+        return *pattern == 0;
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    struct rule {
+        std::string pattern;
+        bool        enabled;
+    };
+    //--------------------------------------------------------------------------
+    call_site_registry() : m_head (nullptr) {}
+    call_site_registry (const call_site_registry&);
+    call_site_registry& operator= (const call_site_registry&);
+    //--------------------------------------------------------------------------
+    static void set_state (call_site& s, bool enabled)
+    {
+        s.m_state.store (enabled ? call_site::on : call_site::off, mo_relaxed);
+    }
+    //--------------------------------------------------------------------------
+    static bool site_matches (const call_site& s, const char* pattern)
+    {
+        if (s.fmt() && wildcard_match (pattern, s.fmt())) {
+            return true;
+        }
+        char  line[16];
+        char* end = line + sizeof line;
+        char* beg = end;
+        *--beg    = 0;
+        unsigned l = s.line();
+        do {
+            *--beg = (char) ('0' + (l % 10));
+            l     /= 10;
+        }
+        while (l);
+        *--beg = ':';
+        std::string fileline (s.file() ? s.file() : "");
+        fileline.append (beg);
+        return wildcard_match (pattern, fileline.c_str());
+    }
+    //--------------------------------------------------------------------------
+    th::mutex         m_mutex;
+    call_site*        m_head;
+    std::vector<rule> m_rules;
+};
+//------------------------------------------------------------------------------
+inline bool call_site::register_site()
+{
+    return call_site_registry::get().add (*this);
+}
+//------------------------------------------------------------------------------
+// Enables or disables the call sites matching "pattern", including the ones
+// whose lines didn't run yet. Returns the number of matching call sites that
+// are already registered.
+//------------------------------------------------------------------------------
+inline uword set_call_sites_enabled (const char* pattern, bool enabled)
+{
+    return call_site_registry::get().set_enabled (pattern, enabled);
+}
+//------------------------------------------------------------------------------
+inline void reset_call_sites()
+{
+    call_site_registry::get().reset();
+}
+//------------------------------------------------------------------------------
+template <class F>
+inline uword for_each_call_site (const char* pattern, F f)
+{
+    return call_site_registry::get().for_each (pattern, f);
+}
+//------------------------------------------------------------------------------
+} //namespace mal
+
+#endif /* MAL_LOG_CALL_SITE_HPP_ */
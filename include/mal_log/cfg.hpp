@@ -41,6 +41,7 @@ either expressed or implied, of Rafael Gago Castano.
 #include <string>
 #include <mal_log/util/integer.hpp>
 #include <mal_log/frontend_types.hpp>
+#include <mal_log/sink.hpp>
 #include <mal_log/util/queue_backoff_cfg.hpp>
 
 namespace mal {
@@ -61,6 +62,14 @@ typedef std::deque<std::string> past_executions_file_list;
       This is trivial with e.g. boost::filesystem, but it can be the case that
       the user simply uses e.g. logrotate, I don't want to force anything now.
 
+  discover_past_files: (POSIX only) when "past_files" is empty the out folder
+      is scanned for files matching "name_prefix", the timestamps written by
+      the logger and "name_suffix", and they are sorted by their timestamps.
+      On exit the rotation list is saved to a small hidden state file on the
+      out folder, which is used instead of scanning while the folder stays
+      untouched (checked through its modification time). The first file of
+      each run is tracked for rotation too.
+
   file_count: simultaneous files to hold on disk. 0 = no rotation
 
   delayed_file_count: When this parameter is 0, the log files are rotated when
@@ -68,12 +77,24 @@ typedef std::deque<std::string> past_executions_file_list;
       time-consuming call on very high load, so setting this parameter to some
       value will allow the worker to skip rotation during high load peaks and
       to wait for the idle state before doing the operation.
+
+  recycle_files: instead of deleting the oldest file and creating a new one
+      the oldest file is renamed and overwritten in place, so rotating costs a
+      rename. Each file is preallocated to "aprox_size" when opened (zeroed
+      first, so the first null byte marks its end if the process dies) and
+      truncated to its real size when closed. The preallocation and zeroing
+      are Linux only, on other platforms a recycled file left by a crashed
+      process may contain old data after its last entry. The files expired
+      while idle because of "delayed_file_count" are deleted, not recycled.
+      Incompatible with "compress_closed_slices" and "preopen_pct".
 */
 //------------------------------------------------------------------------------
 struct rotation_cfg {
     past_executions_file_list past_files;
     uword                     file_count;
     uword                     delayed_file_count;
+    bool                      recycle_files;
+    bool                      discover_past_files;
 };
 //------------------------------------------------------------------------------
 /* out_folder: Existing out folder ended in slash/backslash depending on the
@@ -83,15 +104,71 @@ struct rotation_cfg {
    erase_and_retry_on_fatal_errors: Gives permission to the logger to delete
               the current log file when an unrecoverable filesystem error has
               been found (e.g. disk full).
+
+   compression: "file_compression::lz4" writes the files as LZ4 frames
+              (readable with the standard "lz4" tools). ".lz4" is appended to
+              "name_suffix". "aprox_size" refers to the uncompressed size. The
+              data is compressed in independent blocks of up to 64KB, so a
+              truncated file is readable up to its last complete block.
+
+   compress_closed_slices: compresses the already closed file slices to LZ4
+              frames when the logger is idle (no effect on the hot path).
+              ".lz4" is appended to the compressed file names, the rotation
+              list is updated accordingly. Requires "aprox_size" and no
+              "compression", as the slices would already be compressed.
+
+   durability: how hard the logger tries to get the data on the disk:
+              "none": the data is left on the C library buffers until they
+                  fill up or the file is closed.
+              "flush": (default) the file is flushed to the OS after critical
+                  entries and once per second when idle. Survives process
+                  crashes, not OS crashes or power losses.
+              "fdatasync": as "flush", plus an fdatasync (storage device
+                  commit) every "sync_period_ms" when data was written and
+                  before closing each file.
+              "sync_acks": as "fdatasync", plus an fdatasync before waking up
+                  the "log_*_sync" callers and after batches containing
+                  critical entries. All the sync callers written on the same
+                  batch share one fdatasync, the callers arriving while it is
+                  in progress are grouped on the next one.
+
+   sync_period_ms: fdatasync period for "fdatasync" and "sync_acks".
+
+   preopen_pct: when the current slice reaches this percentage of
+              "aprox_size" the next slice is created and opened by a helper
+              thread, so slicing is just a file handle swap. The old slice is
+              closed and the rotated away files deleted on the helper thread
+              too. 0 disables it (the default), 80 is a sensible value.
 */
 //------------------------------------------------------------------------------
+struct file_compression {
+    enum type {
+        none = 0,
+        lz4  = 1,
+    };
+};
+//------------------------------------------------------------------------------
+struct file_durability {
+    enum level {
+        none      = 0,
+        flush     = 1,
+        fdatasync = 2,
+        sync_acks = 3,
+    };
+};
+//------------------------------------------------------------------------------
 struct file_config {
-    std::string   name_prefix;
-    std::string   name_suffix;
-    std::string   out_folder;
-    uword         aprox_size;
-    rotation_cfg  rotation;
-    bool          erase_and_retry_on_fatal_errors;
+    std::string            name_prefix;
+    std::string            name_suffix;
+    std::string            out_folder;
+    uword                  aprox_size;
+    rotation_cfg           rotation;
+    bool                   erase_and_retry_on_fatal_errors;
+    file_compression::type compression;
+    bool                   compress_closed_slices;
+    file_durability::level durability;
+    uword                  sync_period_ms;
+    uword                  preopen_pct;
 };
 //------------------------------------------------------------------------------
 /* can_use_heap_q: the front end / cosumers are allowed to use the heap.
@@ -136,17 +213,164 @@ struct severity_files {
     std::string stderr_sev_fd;
 };
 //------------------------------------------------------------------------------
-/* producer_timestamp: gets the timestamp on the producer side: adds latency. */
+/* producer_timestamp: gets the timestamp on the producer side: adds latency.
+
+   clock: the clock used for the entry timestamps:
+      "steady": (default) std::chrono::steady_clock, printed relative to the
+          logger initialization. The producer timestamps are taken from a
+          TSC calibrated against it when the CPU has an invariant one.
+      "coarse": CLOCK_MONOTONIC_COARSE (Linux, "steady" elsewhere). Cheaper,
+          with the resolution of the kernel tick (typically 1-4ms).
+      "realtime": std::chrono::system_clock, printed as absolute time since
+          the epoch. To correlate with logs from other hosts.
+      "tsc": the CPU counter (calibrated against the steady clock) for both
+          the producer and the consumer timestamps. "steady" if the CPU
+          doesn't have an invariant counter.
+
+   clock_anchor_period_s: when non-zero, a "[clock_anchor]" line mapping the
+      current timestamp to the realtime clock is written to the file at the
+      start of each file and then at most once each "clock_anchor_period_s"
+      (only while entries are written). Allows relative timestamps to be
+      converted to wall time when post-processing. Ignored on "realtime".
+
+   manual_pump: "init_backend" doesn't launch the logger thread. The entries
+      are consumed when the application calls "frontend::pump" from its own
+      loop (one thread at a time), which also runs the idle work (rotation,
+      flushes, severity files). "frontend::pump_fd" becomes readable when
+      there are entries or work pending; the timed tasks don't make it
+      readable, so "pump" should still be called at least once a second. The
+      "_sync" log calls can't be issued from the pumping thread and
+      "on_termination" has to be called from it (or when nobody is pumping).
+      "consumer_thread" is ignored. The helper threads still are launched if
+      configured.
+*/
+//------------------------------------------------------------------------------
+struct clock_source {
+    enum type {
+        steady   = 0,
+        coarse   = 1,
+        realtime = 2,
+        tsc      = 3,
+    };
+};
 //------------------------------------------------------------------------------
 struct misc_settings {
-    bool producer_timestamp;
+    bool               producer_timestamp;
+    clock_source::type clock;
+    uword              clock_anchor_period_s;
+    bool               manual_pump;
+};
+//------------------------------------------------------------------------------
+/* workers: 0 = the logger thread dequeues, formats and writes the entries one
+      by one (default). A value bigger than zero enables the pipelined mode:
+      the logger thread dequeues the entries in batches and hands them to
+      "workers" formatting threads, each one with its own formatter and
+      render buffer. The logger thread still does all the I/O and writes the
+      rendered batches in the original order.
+
+      Only useful when the formatting (not the I/O) is the bottleneck, as
+      happens on many-core machines with lots of producers. Don't count the
+      logger thread as a worker.
+
+   batch_entries: maximum amount of entries handed to a worker at once.
+*/
+//------------------------------------------------------------------------------
+struct formatting_cfg {
+    uword workers;
+    uword batch_entries;
 };
 //------------------------------------------------------------------------------
+/* dedicated_thread: moves all the file I/O (writing, flushing, slicing and
+      rotating) to a separate thread. The logger thread renders the entries
+      into buffers that are handed to the I/O thread, so a slow filesystem
+      operation doesn't stop the queue from being drained until all the
+      buffers are in flight.
+
+   buffer_count: buffers that can be in flight. Together with "buffer_bytes"
+      this is the amount of slack available for I/O hiccups.
+
+   buffer_bytes: the entries are rendered in batches, each sink gets one write
+      per batch. This is the rendered size that triggers a write (or a
+      hand-over to the I/O thread). The pending data is always written when
+      the queue becomes empty. Also used without the I/O thread.
+*/
+//------------------------------------------------------------------------------
+struct io_cfg {
+    bool  dedicated_thread;
+    uword buffer_count;
+    uword buffer_bytes;
+};
+//------------------------------------------------------------------------------
+/* Streams the log lines to a TCP collector (POSIX only). The logger never
+   waits for the network: the data is buffered in memory and, when the buffer
+   is full because the peer is slow or unreachable, spilled to disk and
+   replayed in order when the connection catches up.
+
+   host: collector host name or address. Empty = disabled (default).
+
+   port: service name or port number.
+
+   severity: minimum severity sent.
+
+   memory_bytes: memory buffer size, above it the data is spilled.
+
+   spill_folder: spill files location. Empty = "file.out_folder". The files
+      are named as the log files with a ".spill" suffix and removed once
+      replayed. The ones pending when the logger stops are left on disk.
+
+   spill_prefix: spill file name prefix.
+
+   spill_file_bytes: approximate spill file size.
+
+   spill_max_files: when exceeded the oldest spill file is discarded. 0 = no
+      limit.
+*/
+//------------------------------------------------------------------------------
+struct tcp_cfg {
+    std::string   host;
+    std::string   port;
+    sev::severity severity;
+    uword         memory_bytes;
+    std::string   spill_folder;
+    std::string   spill_prefix;
+    uword         spill_file_bytes;
+    uword         spill_max_files;
+};
+//------------------------------------------------------------------------------
+/* sinks: additional user defined destinations (see "sink.hpp"), written
+      after the file and the console in the order they appear here. They are
+      kept alive by the logger until its destruction. Wrap them in an
+      "async_sink" to give them their own queue and thread.
+
+   console_queue: gives stderr and stdout a queue and a thread each, so a slow
+      terminal or a full pipe doesn't stall the file. Disabled by default. With
+      "sink_overflow::drop" console lines can be lost under load, the file is
+      unaffected. Its "thread" is used for both threads when set, otherwise
+      "helper_threads" is.
+
+   consumer_thread: CPU set, scheduling and name of the logger thread (see
+      "util/thread_setup.hpp"). Applied by the thread itself at startup.
+      Inherited from the thread calling "init_backend" by default.
+
+   helper_threads: the same for every other thread the logger creates: the
+      formatting workers, the I/O thread, the console queues (unless
+      "console_queue.thread" is set), the slicing thread and the TCP sink.
+      Their names are "name" plus ".fmt", ".io", ".stderr", ".stdout",
+      ".slice" or ".tcp".
+*/
+//------------------------------------------------------------------------------
 struct cfg {
     file_config          file;
     queue_config         queue;
     visualization_config display;
     severity_files       sev;
+    formatting_cfg       formatting;
+    io_cfg               io;
+    sink_list            sinks;
+    sink_queue_cfg       console_queue;
+    tcp_cfg              tcp;
+    thread_cfg           consumer_thread;
+    thread_cfg           helper_threads;
     queue_backoff_cfg    consumer_backoff; // read the code before tweaking
     queue_backoff_cfg    producer_backoff; // read the code before tweaking
     misc_settings        misc;
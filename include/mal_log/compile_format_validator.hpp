@@ -42,6 +42,7 @@ either expressed or implied, of Rafael Gago Castano.
 #include <mal_log/util/integer.hpp>
 #include <mal_log/util/literal.hpp>
 #include <mal_log/format_tokens.hpp>
+#include <mal_log/frontend_types.hpp>
 
 namespace mal {
 
@@ -156,6 +157,18 @@ private:
     }
     //--------------------------------------------------------------------------
     template <class T>
+    static constexpr typename std::enable_if<
+        std::is_same<T, deep_copy_bytes>::value,
+        bool
+        >::type
+    is_formatting_valid (char f, T*)
+    {
+        return (f == fmt::hex)    ? true :
+               (f == fmt::base64) ? true :
+                                    false;
+    }
+    //--------------------------------------------------------------------------
+    template <class T>
     static constexpr bool is_formatting_valid (char c, ...)
     {
         return false;
@@ -0,0 +1,89 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_SHM_RING_HPP_
+#define MAL_LOG_SHM_RING_HPP_
+
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/atomic.hpp>
+
+// Layout of the shared memory ring written by "shm_ring_sink" and read by
+// "shm_ring_reader". The file is a "header_bytes" header followed by the data
+// area, a circular byte stream of rendered log lines ('\n' terminated).
+//
+// The stream is addressed by a monotonic byte sequence: byte "n" of the stream
+// lives at "data_offset + (n & (capacity - 1))". There is a single writer and
+// any number of readers. Readers don't stall the writer, a reader that falls
+// behind more than "capacity" bytes loses data.
+//
+// Write protocol (seqlock like):
+//   1. "reserved" = end of the bytes about to be written. (release fence)
+//   2. The data is copied.
+//   3. "committed" = "reserved" (release). "lines" is incremented.
+//
+// Read protocol:
+//   1. end = "committed" (acquire).
+//   2. Copy [position, end), with position >= end - capacity.
+//   3. (acquire fence) r = "reserved". Bytes before "r - capacity" may have
+//      been overwritten while copying: they are discarded as lost.
+//
+// "session" changes each time a writer creates the file. All the multibyte
+// fields are in native byte order, the file is meant for local readers.
+
+namespace mal { namespace extras { namespace shm_ring {
+
+//------------------------------------------------------------------------------
+static const u32   magic        = 0x524c414d;                                   //"MALR" on little endian
+static const u32   version      = 1;
+static const uword header_bytes = 4096;
+//------------------------------------------------------------------------------
+struct header {
+    atomic_u32    magic;                                                        //written last on creation
+    u32           version;
+    u64           capacity;                                                     //power of two
+    u64           data_offset;
+    u64           session;
+    char          pad0[32];
+    atomic_u64    reserved;                                                     //own cache line, as the readers poll "committed"
+    char          pad1[56];
+    atomic_u64    committed;
+    atomic_u64    lines;
+    char          pad2[48];
+};
+//------------------------------------------------------------------------------
+}}} //namespaces
+
+#endif /* MAL_LOG_SHM_RING_HPP_ */
@@ -0,0 +1,226 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_SHM_RING_READER_HPP_
+#define MAL_LOG_SHM_RING_READER_HPP_
+
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <mal_log/util/integer.hpp>
+#include <mal_log/extras/shm_ring.hpp>
+
+//POSIX only. Reader side of "shm_ring_sink", see "shm_ring.hpp". Doesn't
+//depend on the logger library. Each reader has its own position, the writer
+//is never slowed down by readers.
+
+namespace mal { namespace extras {
+//------------------------------------------------------------------------------
+class shm_ring_reader
+{
+public:
+    //--------------------------------------------------------------------------
+    shm_ring_reader()
+    {
+        m_hdr     = nullptr;
+        m_data    = nullptr;
+        m_map     = 0;
+        m_mask    = 0;
+        m_pos     = 0;
+        m_session = 0;
+        m_ino     = 0;
+        m_lost    = 0;
+        m_resync  = false;
+    }
+    //--------------------------------------------------------------------------
+    ~shm_ring_reader()
+    {
+        close();
+    }
+    //--------------------------------------------------------------------------
+    bool open (const char* path, bool from_oldest = false)                      //false: only new lines are read
+    {
+        close();
+        int fd = ::open (path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        void* mem = MAP_FAILED;
+        if (::fstat (fd, &st) == 0 &&
+            (uword) st.st_size > shm_ring::header_bytes
+            ) {
+            mem = ::mmap (nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close (fd);
+        if (mem == MAP_FAILED) {
+            return false;
+        }
+        auto h = (const shm_ring::header*) mem;
+        if (h->magic.load (mo_acquire) != shm_ring::magic ||
+            h->version != shm_ring::version ||
+            h->data_offset + h->capacity != (u64) st.st_size
+            ) {
+            ::munmap (mem, st.st_size);
+            return false;
+        }
+        m_hdr     = h;
+        m_data    = ((const char*) mem) + h->data_offset;
+        m_map     = (uword) st.st_size;
+        m_mask    = (uword) h->capacity - 1;
+        m_session = h->session;
+        m_ino     = (u64) st.st_ino;
+        m_lost    = 0;
+        u64 end   = h->committed.load (mo_acquire);
+        m_pos     = from_oldest ? oldest (end) : end;
+        m_resync  = from_oldest && (m_pos != 0);
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    void close()
+    {
+        if (m_hdr) {
+            ::munmap ((void*) m_hdr, m_map);
+            m_hdr = nullptr;
+        }
+    }
+    //--------------------------------------------------------------------------
+    bool is_open() const
+    {
+        return m_hdr != nullptr;
+    }
+    //--------------------------------------------------------------------------
+    bool replaced (const char* path) const                                      //the writer recreated the file (e.g. restarted)
+    {
+        struct stat st;
+        if (::stat (path, &st) != 0) {
+            return false;
+        }
+        return (u64) st.st_ino != m_ino || m_hdr->session != m_session;
+    }
+    //--------------------------------------------------------------------------
+    uword read (char* buf, uword buf_size)                                      //returns the bytes copied, always whole lines
+    {
+        assert (m_hdr && buf && buf_size);
+        u64 end = m_hdr->committed.load (mo_acquire);
+        u64 old = oldest (end);
+        if (m_pos < old) {
+            m_lost   += old - m_pos;
+            m_pos     = old;
+            m_resync  = true;
+        }
+        uword size = (uword) (end - m_pos);
+        size       = (size <= buf_size) ? size : buf_size;
+        copy (buf, m_pos, size);
+        at::atomic_thread_fence (mo_acquire);
+        u64 valid = oldest (m_hdr->reserved.load (mo_relaxed));
+        uword bad = 0;
+        if (valid > m_pos) {                                                    //overwritten while copying
+            bad       = (valid - m_pos < size) ? (uword) (valid - m_pos) : size;
+            m_lost   += bad;
+            m_resync  = true;
+        }
+        if (m_resync && bad < size) {                                           //skip the partial line
+            auto  nl   = (const char*) std::memchr (buf + bad, '\n', size - bad);
+            uword skip = nl ? (uword) (nl - buf) + 1 - bad : size - bad;
+            m_lost   += skip;
+            bad      += skip;
+            m_resync  = (nl == nullptr);
+        }
+        m_pos += size;
+        size  -= bad;
+        std::memmove (buf, buf + bad, size);
+        size   = last_line_end (buf, size, m_pos);
+        return size;
+    }
+    //--------------------------------------------------------------------------
+    u64 lost() const                                                            //bytes
+    {
+        return m_lost;
+    }
+    //--------------------------------------------------------------------------
+    u64 lines_written() const
+    {
+        return m_hdr->lines.load (mo_relaxed);
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    u64 oldest (u64 end) const
+    {
+        u64 cap = (u64) m_mask + 1;
+        return (end > cap) ? end - cap : 0;
+    }
+    //--------------------------------------------------------------------------
+    uword last_line_end (const char* buf, uword size, u64& pos)                 //a partial line is left for the next read
+    {
+        uword i = size;
+        while (i && buf[i - 1] != '\n') {
+            --i;
+        }
+        if (i == 0 && size) {                                                   //line bigger than the buffer
+            return size;
+        }
+        pos -= size - i;
+        return i;
+    }
+    //--------------------------------------------------------------------------
+    void copy (char* dst, u64 pos, uword size)
+    {
+        uword cap    = m_mask + 1;
+        uword offset = (uword) (pos & m_mask);
+        uword first  = (size <= cap - offset) ? size : cap - offset;
+        std::memcpy (dst, m_data + offset, first);
+        std::memcpy (dst + first, m_data, size - first);
+    }
+    //--------------------------------------------------------------------------
+    const shm_ring::header* m_hdr;
+    const char*             m_data;
+    uword                   m_map;
+    uword                   m_mask;
+    u64                     m_pos;
+    u64                     m_session;
+    u64                     m_ino;
+    u64                     m_lost;
+    bool                    m_resync;
+};
+//------------------------------------------------------------------------------
+}} //namespaces
+
+#endif /* MAL_LOG_SHM_RING_READER_HPP_ */
@@ -0,0 +1,183 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_SHM_RING_SINK_HPP_
+#define MAL_LOG_SHM_RING_SINK_HPP_
+
+#include <cassert>
+#include <cstring>
+#include <cstdio>
+#include <new>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <mal_log/util/chrono.hpp>
+#include <mal_log/sink.hpp>
+#include <mal_log/extras/shm_ring.hpp>
+
+//POSIX only. Publishes the log lines on a memory mapped ring file (see
+//"shm_ring.hpp" for the format) so local readers (e.g. "mal_tail" or a log
+//shipper using "shm_ring_reader.hpp") get them without going through the
+//filesystem. Use a tmpfs location, e.g. "/dev/shm/my_app.log_ring".
+//
+//The file is recreated on "init" and left in place on "close", so readers can
+//finish draining it. "init" builds the new file aside and renames it over the
+//path: readers mapping the previous file keep its inode (truncating it would
+//SIGBUS them) and notice the new one by its inode and "session".
+
+namespace mal { namespace extras {
+//------------------------------------------------------------------------------
+class shm_ring_sink : public sink
+{
+public:
+    //--------------------------------------------------------------------------
+    shm_ring_sink (sev::severity s = sev::notice) : sink (s)
+    {
+        m_hdr  = nullptr;
+        m_data = nullptr;
+        m_mask = 0;
+        m_map  = 0;
+    }
+    //--------------------------------------------------------------------------
+    ~shm_ring_sink()
+    {
+        close();
+    }
+    //--------------------------------------------------------------------------
+    bool init (const char* path, uword capacity = 4 * 1024 * 1024)              //capacity is rounded up to a power of two
+    {
+        assert (!m_hdr);
+        uword cap = 4096;
+        while (cap < capacity) {
+            cap *= 2;
+        }
+        std::string tmp = std::string (path) + ".tmp";
+        int fd = ::open (tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        uword map = shm_ring::header_bytes + cap;
+        void* mem = MAP_FAILED;
+        if (::ftruncate (fd, (off_t) map) == 0) {
+            mem = ::mmap(
+                nullptr, map, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0
+                );
+        }
+        ::close (fd);
+        if (mem == MAP_FAILED) {
+            ::unlink (tmp.c_str());
+            return false;
+        }
+        auto h         = new (mem) shm_ring::header();
+        h->version     = shm_ring::version;
+        h->capacity    = cap;
+        h->data_offset = shm_ring::header_bytes;
+        h->session     = (u64) ch::duration_cast<ch::nanoseconds>(
+            ch::system_clock::now().time_since_epoch()
+            ).count();
+        h->reserved.store (0, mo_relaxed);
+        h->committed.store (0, mo_relaxed);
+        h->lines.store (0, mo_relaxed);
+        h->magic.store (shm_ring::magic, mo_release);
+        if (std::rename (tmp.c_str(), path) != 0) {
+            ::munmap (mem, map);
+            ::unlink (tmp.c_str());
+            return false;
+        }
+        m_hdr  = h;
+        m_data = ((char*) mem) + shm_ring::header_bytes;
+        m_mask = cap - 1;
+        m_map  = map;
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    virtual void write (const sink_span* spans, uword count)
+    {
+        if (!m_hdr) {
+            return;
+        }
+        u64   pos   = m_hdr->committed.load (mo_relaxed);
+        u64   bytes = 0;
+        u64   lines = 0;
+        for (uword i = 0; i < count; ++i) {
+            bytes += spans[i].size;
+            lines += spans[i].entries;
+        }
+        m_hdr->reserved.store (pos + bytes, mo_relaxed);
+        at::atomic_thread_fence (mo_release);
+        for (uword i = 0; i < count; ++i) {
+            copy (pos, spans[i].data, spans[i].size);
+            pos += spans[i].size;
+        }
+        m_hdr->committed.store (pos, mo_release);
+        m_hdr->lines.fetch_add (lines, mo_relaxed);
+    }
+    //--------------------------------------------------------------------------
+    virtual void close()
+    {
+        if (m_hdr) {
+            ::munmap ((void*) m_hdr, m_map);
+            m_hdr = nullptr;
+        }
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    void copy (u64 pos, const char* src, uword size)
+    {
+        uword cap = m_mask + 1;
+        if (size > cap) {                                                       //only the tail survives
+            pos  += size - cap;
+            src  += size - cap;
+            size  = cap;
+        }
+        uword offset = (uword) (pos & m_mask);
+        uword first  = (size <= cap - offset) ? size : cap - offset;
+        std::memcpy (m_data + offset, src, first);
+        std::memcpy (m_data, src + first, size - first);
+    }
+    //--------------------------------------------------------------------------
+    shm_ring::header* m_hdr;
+    char*             m_data;
+    uword             m_mask;
+    uword             m_map;
+};
+//------------------------------------------------------------------------------
+}} //namespaces
+
+#endif /* MAL_LOG_SHM_RING_SINK_HPP_ */
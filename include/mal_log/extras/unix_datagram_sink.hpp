@@ -0,0 +1,326 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_UNIX_DATAGRAM_SINK_HPP_
+#define MAL_LOG_UNIX_DATAGRAM_SINK_HPP_
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <mal_log/util/chrono.hpp>
+#include <mal_log/util/atomic.hpp>
+#include <mal_log/sink.hpp>
+
+//POSIX only. Sends each log line as an RFC 5424 message to a Unix datagram
+//socket, e.g. the local syslog daemon or journald ("/dev/log"). The lines are
+//sent in batches through "sendmmsg" (Linux) without copying them. The socket
+//is non-blocking: when its buffer is full the remaining lines of the batch are
+//dropped and counted instead of stalling the logger.
+//
+//The message timestamp is the time of the batch write, the logger timestamp is
+//still on the message text if enabled.
+
+namespace mal { namespace extras {
+//------------------------------------------------------------------------------
+class unix_datagram_sink : public sink
+{
+public:
+    //--------------------------------------------------------------------------
+    static const uword batch_max = 64;
+    //--------------------------------------------------------------------------
+    unix_datagram_sink (sev::severity s = sev::notice) : sink (s)
+    {
+        m_fd         = -1;
+        m_dropped    = 0;
+        m_next_retry = 0;
+    }
+    //--------------------------------------------------------------------------
+    ~unix_datagram_sink()
+    {
+        close();
+    }
+    //--------------------------------------------------------------------------
+    bool init(
+        const char* socket_path = "/dev/log",
+        const char* app_name    = "mal",
+        uword       facility    = 1                                             //user-level
+        )
+    {
+        assert (m_fd < 0);
+        assert (facility < 24);
+        if (std::strlen (socket_path) >= sizeof ((sockaddr_un*) 0)->sun_path) {
+            return false;
+        }
+        m_path = socket_path;
+        for (uword s = sev::debug; s < sev::off; ++s) {
+            static const unsigned syslog_sev[] = { 7, 7, 5, 4, 3, 2 };
+            char pri[8];
+            int  len = std::snprintf(
+                pri,
+                sizeof pri,
+                "<%u>1 ",
+                (unsigned) (facility * 8 + syslog_sev[s])
+                );
+            m_pri[s].assign (pri, len);
+        }
+        char host[256];
+        if (::gethostname (host, sizeof host) != 0) {
+            host[0] = 0;
+        }
+        host[sizeof host - 1] = 0;
+        char pid[32];
+        std::snprintf (pid, sizeof pid, "%d", (int) ::getpid());
+        m_fields  = " ";
+        m_fields += host[0] ? host : "-";
+        m_fields += " ";
+        m_fields += (app_name && app_name[0]) ? app_name : "-";
+        m_fields += " ";
+        m_fields += pid;
+        m_fields += " - - ";                                                    //MSGID, STRUCTURED-DATA
+        return connect();
+    }
+    //--------------------------------------------------------------------------
+    virtual void write (const sink_span* spans, uword count)
+    {
+        if (m_fd < 0 && !reconnect()) {
+            drop (spans, count);
+            return;
+        }
+        update_header();
+        uword msgs = 0;
+        for (uword i = 0; i < count; ++i) {
+            const sink_span& s = spans[i];
+            assert (s.min_sev == s.max_sev);
+            const char* line = s.data;
+            const char* end  = s.data + s.size;
+            while (line < end) {
+                auto nl = (const char*) std::memchr (line, '\n', end - line);
+                const char* line_end = nl ? nl : end;
+                prepare (msgs, s.min_sev, line, line_end - line);
+                line = line_end + 1;
+                if (++msgs == batch_max) {
+                    if (!send (msgs)) {
+                        drop (line, end, spans + i + 1, count - i - 1);
+                        return;
+                    }
+                    msgs = 0;
+                }
+            }
+        }
+        if (msgs) {
+            send (msgs);
+        }
+    }
+    //--------------------------------------------------------------------------
+    virtual void close()
+    {
+        if (m_fd >= 0) {
+            ::close (m_fd);
+            m_fd = -1;
+        }
+    }
+    //--------------------------------------------------------------------------
+    virtual bool split_by_severity() const
+    {
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    uword dropped() const                                                       //lines
+    {
+        return m_dropped;
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    bool connect()
+    {
+        int fd = ::socket (AF_UNIX, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+        sockaddr_un addr;
+        std::memset (&addr, 0, sizeof addr);
+        addr.sun_family = AF_UNIX;
+        std::strcpy (addr.sun_path, m_path.c_str());
+        int flags = ::fcntl (fd, F_GETFL, 0);
+        if (flags < 0 ||
+            ::fcntl (fd, F_SETFL, flags | O_NONBLOCK) != 0 ||
+            ::fcntl (fd, F_SETFD, FD_CLOEXEC) != 0 ||
+            ::connect (fd, (const sockaddr*) &addr, sizeof addr) != 0
+            ) {
+            ::close (fd);
+            return false;
+        }
+        m_fd = fd;
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    bool reconnect()                                                            //at most once per second
+    {
+        u64 now = (u64) ch::duration_cast<ch::milliseconds>(
+            ch::steady_clock::now().time_since_epoch()
+            ).count();
+        if (now < m_next_retry) {
+            return false;
+        }
+        m_next_retry = now + 1000;
+        close();
+        return connect();
+    }
+    //--------------------------------------------------------------------------
+    void update_header()                                                        //TIMESTAMP HOSTNAME APP-NAME PROCID MSGID SD
+    {
+        auto now = ch::system_clock::now();
+        auto us  = ch::duration_cast<ch::microseconds>(
+            now.time_since_epoch()
+            ).count();
+        std::time_t secs = (std::time_t) (us / 1000000);
+        std::tm     t;
+        ::gmtime_r (&secs, &t);
+        char ts[64];
+        int len = (int) std::strftime (ts, sizeof ts, "%Y-%m-%dT%H:%M:%S", &t);
+        len += std::snprintf(
+            ts + len, sizeof ts - len, ".%06uZ", (unsigned) (us % 1000000)
+            );
+        m_header.assign (ts, len);
+        m_header += m_fields;
+    }
+    //--------------------------------------------------------------------------
+    void prepare (uword msg, sev::severity s, const char* line, uword size)
+    {
+        iovec* iov      = &m_iov[msg * 3];
+        iov[0].iov_base = (void*) m_pri[s].data();
+        iov[0].iov_len  = m_pri[s].size();
+        iov[1].iov_base = (void*) m_header.data();
+        iov[1].iov_len  = m_header.size();
+        iov[2].iov_base = (void*) line;
+        iov[2].iov_len  = size;
+#if defined (__linux__)
+        mmsghdr& m      = m_msgs[msg];
+        std::memset (&m, 0, sizeof m);
+        m.msg_hdr.msg_iov    = iov;
+        m.msg_hdr.msg_iovlen = 3;
+#endif
+    }
+    //--------------------------------------------------------------------------
+    bool send (uword msgs)                                                      //false: the socket is full or broken
+    {
+        uword sent = 0;
+        while (sent < msgs) {
+#if defined (__linux__)
+            int r = ::sendmmsg (m_fd, &m_msgs[sent], msgs - sent, 0);
+#else
+            msghdr h;
+            std::memset (&h, 0, sizeof h);
+            h.msg_iov    = &m_iov[sent * 3];
+            h.msg_iovlen = 3;
+            int r        = (::sendmsg (m_fd, &h, 0) < 0) ? -1 : 1;
+#endif
+            if (r > 0) {
+                sent += (uword) r;
+                continue;
+            }
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            if (r < 0 && errno == EMSGSIZE) {                                   //just this message
+                m_dropped = m_dropped + 1;
+                ++sent;
+                continue;
+            }
+            m_dropped = m_dropped + (msgs - sent);
+            if (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                close();                                                        //e.g. the daemon was restarted
+            }
+            return false;
+        }
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    static uword lines (const char* beg, const char* end)
+    {
+        uword n = 0;
+        while (beg < end) {
+            auto nl = (const char*) std::memchr (beg, '\n', end - beg);
+            ++n;
+            beg = nl ? nl + 1 : end;
+        }
+        return n;
+    }
+    //--------------------------------------------------------------------------
+    void drop (const sink_span* spans, uword count)
+    {
+        uword n = 0;
+        for (uword i = 0; i < count; ++i) {
+            n += spans[i].entries;
+        }
+        m_dropped = m_dropped + n;
+    }
+    //--------------------------------------------------------------------------
+    void drop(
+        const char* beg, const char* end, const sink_span* spans, uword count
+        )
+    {
+        m_dropped = m_dropped + lines (beg, end);
+        drop (spans, count);
+    }
+    //--------------------------------------------------------------------------
+    int                      m_fd;
+    std::string              m_path;
+    std::string              m_pri[sev::off];
+    std::string              m_fields;
+    std::string              m_header;
+    iovec                    m_iov[batch_max * 3];
+#if defined (__linux__)
+    mmsghdr                  m_msgs[batch_max];
+#endif
+    mo_relaxed_atomic<uword> m_dropped;
+    u64                      m_next_retry;
+};
+//------------------------------------------------------------------------------
+}} //namespaces
+
+#endif /* MAL_LOG_UNIX_DATAGRAM_SINK_HPP_ */
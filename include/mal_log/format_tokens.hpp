@@ -47,6 +47,7 @@ static const char full_width        = 'w';
 static const char hex               = 'x';
 static const char scientific        = 's';
 static const char ascii             = 'c';
+static const char base64            = 'b';
 
 //------------------------------------------------------------------------------
 }} //namespaces
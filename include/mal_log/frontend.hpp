@@ -38,9 +38,11 @@ either expressed or implied, of Rafael Gago Castano.
 #define MAL_LOG_LOG_FRONTEND_HPP_
 
 #include <mal_log/util/system.hpp>
+#include <mal_log/util/atomic.hpp>
 #include <mal_log/serialization/exporter.hpp>
 #include <mal_log/cfg.hpp>
 #include <mal_log/util/thread.hpp>
+#include <mal_log/timestamp.hpp>
 
 namespace mal {
 
@@ -48,8 +50,70 @@ class sync_point;
 //------------------------------------------------------------------------------
 struct timestamp_data
 {
-    u64  base;
-    bool producer_timestamps;
+    u64                base;                                                    //on "clock" units. The TSC one too
+    bool               producer_timestamps;
+    clock_source::type clock;                                                   //the one in use, not the configured one
+};
+//------------------------------------------------------------------------------
+inline u64 get_entry_timestamp (const timestamp_data& td)                       //TSC timestamps are raw ticks
+{
+    switch (td.clock) {
+    case clock_source::tsc:      return get_tsc_timestamp() - td.base;
+    case clock_source::coarse:   return get_coarse_ns_timestamp() - td.base;
+    case clock_source::realtime: return get_realtime_ns_timestamp() - td.base;
+    default:                     return get_ns_timestamp() - td.base;
+    }
+}
+//------------------------------------------------------------------------------
+// The word tested inline by "frontend::can_log". It holds the minimum severity
+// plus two bits above any severity value: one set until the logger is
+// initialized and one set (forever) once it is terminated. So an entry that is
+// filtered out costs one relaxed load and a compare, without calling into the
+// library. It's padded to a cache line of its own, as it's read on every log
+// call but just written when the severities or the logger state change.
+//------------------------------------------------------------------------------
+class severity_filter
+{
+public:
+    //--------------------------------------------------------------------------
+    static const uword no_init_bit    = 1 << 8;
+    static const uword terminated_bit = 1 << 9;
+    static const uword state_mask     = no_init_bit | terminated_bit;
+    //--------------------------------------------------------------------------
+    severity_filter()
+    {
+        m_word.store (no_init_bit | (uword) sev::notice, mo_relaxed);
+    }
+    //--------------------------------------------------------------------------
+    bool can_log (sev::severity s) const
+    {
+        return ((uword) s) >= m_word.load (mo_relaxed);
+    }
+    //--------------------------------------------------------------------------
+    sev::severity min_severity() const
+    {
+        return (sev::severity) (m_word.load (mo_relaxed) & ~state_mask);
+    }
+    //--------------------------------------------------------------------------
+    void set_min_severity (sev::severity s)
+    {
+        uword w = m_word.load (mo_relaxed);
+        while (!m_word.compare_exchange_weak(
+                w, (w & state_mask) | (uword) s, mo_relaxed, mo_relaxed
+                ))
+        {}
+    }
+    //--------------------------------------------------------------------------
+    void set_initialized() { m_word.fetch_and (~no_init_bit, mo_release); }
+    void set_terminated()  { m_word.fetch_or (terminated_bit, mo_relaxed); }
+    //--------------------------------------------------------------------------
+private:
+    severity_filter (const severity_filter&);
+    severity_filter& operator= (const severity_filter&);
+
+    u8           m_pad1[cache_line_size];
+    atomic_uword m_word;
+    u8           m_pad2[cache_line_size - sizeof (atomic_uword)];
 };
 //------------------------------------------------------------------------------
 class MAL_LIB_EXPORTED_CLASS frontend
@@ -77,7 +141,8 @@ public:
     //--------------------------------------------------------------------------
     sev::severity min_severity() const;
     //--------------------------------------------------------------------------
-    bool can_log (sev::severity s) const;
+    // inlined, see "severity_filter"
+    bool can_log (sev::severity s) const { return m_filter.can_log (s); }
     //--------------------------------------------------------------------------
     void set_file_severity (sev::severity s);
     //--------------------------------------------------------------------------
@@ -85,6 +150,9 @@ public:
             sev::severity std_err, sev::severity std_out = sev::off
             );
     //--------------------------------------------------------------------------
+    // for sinks registered through "cfg::sinks"
+    void set_sink_severity (sink& s, sev::severity sev);
+    //--------------------------------------------------------------------------
     ser::exporter get_encoder (uword required_bytes, sev::severity s);
     //--------------------------------------------------------------------------
     void async_push_encoded (ser::exporter& encoder);
@@ -103,13 +171,24 @@ public:
     // the queue can be left completely empty (no memory leaks).
     void on_termination();
     //--------------------------------------------------------------------------
+    // "cfg::misc.manual_pump" mode only. Consumes up to "max_entries" entries
+    // or during up to "max_ns" nanoseconds (0 = no limit), then runs the due
+    // idle tasks. Returns the number of entries consumed. When work is left
+    // "pump_fd" is left readable.
+    uword pump (uword max_entries = 0, u64 max_ns = 0);
+    //--------------------------------------------------------------------------
+    // readable when "pump" has work to do. -1 when not available (Windows or
+    // not in manual pump mode). Never read from or write to it.
+    int pump_fd() const;
+    //--------------------------------------------------------------------------
     timestamp_data get_timestamp_data() const;
     //--------------------------------------------------------------------------
     u64 timestamp_base() const;
     //--------------------------------------------------------------------------
 private:
     class frontend_impl;
-    frontend_impl* m;
+    frontend_impl*  m;
+    severity_filter m_filter;
 
 }; //class log_backed
 //------------------------------------------------------------------------------
@@ -39,6 +39,7 @@ either expressed or implied, of Rafael Gago Castano.
 
 #include <memory>
 #include <cassert>
+#include <cstring>
 #include <string>
 #include <type_traits>
 #include <mal_log/frontend.hpp>
@@ -60,6 +61,193 @@ inline bool prebuild_data (T& v, field& f, uword& total_length)
     return (total_length >= (total_length - clength));
 }
 //------------------------------------------------------------------------------
+// Wraps a frontend to request the fixed width encoding on one call site only,
+// e.g: "log_error_i (mal::fixed_width (fe), "value {}", v)". Integers are then
+// encoded on all the bytes of its type: the entry size is a compile time
+// constant and there are no data dependent branches on the producer, at the
+// cost of some queue space. Defining MAL_NO_VARIABLE_INTEGER_WIDTH makes this
+// the default for all the call sites.
+//------------------------------------------------------------------------------
+struct fixed_width_frontend
+{
+    frontend& fe;
+
+    bool can_log (sev::severity s) const { return fe.can_log (s); }
+    operator frontend&() const           { return fe; }                         //variable width on compilers without variadic templates
+};
+//------------------------------------------------------------------------------
+inline fixed_width_frontend fixed_width (frontend& fe)
+{
+    fixed_width_frontend f = { fe };
+    return f;
+}
+//------------------------------------------------------------------------------
+#ifdef MAL_HAS_VARIADIC_TEMPLATES
+
+namespace detail {
+//------------------------------------------------------------------------------
+struct variable_width_encoding {};
+struct fixed_width_encoding {};
+#ifndef MAL_NO_VARIABLE_INTEGER_WIDTH
+    typedef variable_width_encoding default_encoding;
+#else
+    typedef fixed_width_encoding default_encoding;
+#endif
+//------------------------------------------------------------------------------
+template <class T>
+struct is_fixed_width_candidate
+{
+    static const bool value =
+        std::is_integral<T>::value && !std::is_same<T, bool>::value;
+};
+//------------------------------------------------------------------------------
+// The argument fields are one byte each (see "fields.hpp"). They are kept on
+// a flat byte array between the sizing and the encoding instead of on an
+// aggregate, so the compiler can keep them in registers. These are applied to
+// the argument pack by braced list expansions (evaluated in order), so there
+// is no recursion: one instantiation per argument type.
+//------------------------------------------------------------------------------
+template <class T, class encoding>
+inline typename std::enable_if<
+    !std::is_same<encoding, fixed_width_encoding>::value ||
+    !is_fixed_width_candidate<T>::value,
+    uword
+    >::type
+prebuild_arg (T& v, u8& field, encoding)
+{
+    typedef ser::exporter exp;
+    uword bytes = exp::bytes_required (v);
+    auto  f     = exp::get_field (v, bytes);
+    static_assert (sizeof f == sizeof field, "fields should be one byte");
+    std::memcpy (&field, &f, sizeof f);
+    return bytes;
+}
+//------------------------------------------------------------------------------
+template <class T>
+inline typename std::enable_if<is_fixed_width_candidate<T>::value, uword>::type
+prebuild_arg (T& v, u8& field, fixed_width_encoding)
+{
+    typedef ser::exporter exp;
+    auto f = exp::get_fixed_field (v);
+    static_assert (sizeof f == sizeof field, "fields should be one byte");
+    std::memcpy (&field, &f, sizeof f);
+    return exp::fixed_bytes_required (v);
+}
+//------------------------------------------------------------------------------
+template <class T, class encoding>
+inline typename std::enable_if<
+    !std::is_same<encoding, fixed_width_encoding>::value ||
+    !is_fixed_width_candidate<T>::value,
+    int
+    >::type
+export_arg (ser::exporter& enc, T& v, u8 field, encoding)
+{
+    decltype (ser::exporter::get_field (v, 0)) f;
+    std::memcpy (&f, &field, sizeof f);
+    enc.do_export (v, f);
+    return 0;
+}
+//------------------------------------------------------------------------------
+template <class T>
+inline typename std::enable_if<is_fixed_width_candidate<T>::value, int>::type
+export_arg (ser::exporter& enc, T& v, u8 field, fixed_width_encoding)
+{
+    decltype (ser::exporter::get_fixed_field (v)) f;
+    std::memcpy (&f, &field, sizeof f);
+    enc.do_export_fixed (v, f);
+    return 0;
+}
+//------------------------------------------------------------------------------
+inline uword header_bytes_required (ser::header_data h, variable_width_encoding)
+{
+    return ser::exporter::bytes_required (h);
+}
+//------------------------------------------------------------------------------
+inline uword header_bytes_required (ser::header_data h, fixed_width_encoding)
+{
+    return ser::exporter::fixed_bytes_required (h);
+}
+//------------------------------------------------------------------------------
+template <bool is_async, class encoding, class... Args>
+bool encode_entry(
+    frontend& fe, sev::severity sv, const char* fmt, Args... args
+    )
+{
+    static_assert(
+        sizeof... (Args) < (1 << ser::header_field::arity_bits),
+        "too many arguments"
+        );
+    typedef ser::exporter exp;
+
+    ser::header_data                   hdr;
+    decltype (exp::get_field (hdr, 0)) hdr_field;
+    u8                                 fields[sizeof... (Args) + 1];            //+1: no zero sized arrays
+
+    uword length = 0;
+    u8*   field  = fields;
+    uword sizes[] = {
+        0, (length += prebuild_arg (args, *field++, encoding()))...
+        };
+    (void) sizes;
+
+    auto td = fe.get_timestamp_data();
+    hdr     = ser::make_header_data(
+        sv, fmt, sizeof... (Args), td.producer_timestamps
+        );
+    if (hdr.has_tstamp) {                                                        //the clock call is slow (2x slower producers), the TSC read isn't
+        hdr.tstamp = get_entry_timestamp (td);
+    }
+    sync_point sync;
+    if (!is_async) {
+        hdr.sync = &sync;
+    }
+    uword hdr_length = header_bytes_required (hdr, encoding());
+    hdr_field        = exp::get_field (hdr, hdr_length);
+    length          += hdr_length;
+
+    auto enc = fe.get_encoder (length, sv);
+    if (enc.has_memory()) {
+        enc.do_export (hdr, hdr_field);
+        const u8* exp_field = fields;
+        int exported[] = {
+            0, export_arg (enc, args, *exp_field++, encoding())...
+            };
+        (void) exported;
+        if (is_async) {
+            fe.async_push_encoded (enc);
+            return true;
+        }
+        else {
+            return fe.sync_push_encoded (enc, sync);
+        }
+    }
+    return false;
+}
+//------------------------------------------------------------------------------
+} //namespace detail
+//------------------------------------------------------------------------------
+template <bool is_async, class... Args>
+inline bool new_entry(                                                          //don't use this directly, use the macros!
+    frontend& fe, sev::severity sv, const char* fmt, Args... args
+    )
+{
+    return detail::encode_entry<is_async, detail::default_encoding>(
+        fe, sv, fmt, args...
+        );
+}
+//------------------------------------------------------------------------------
+template <bool is_async, class... Args>
+inline bool new_entry(                                                          //don't use this directly, use the macros!
+    fixed_width_frontend fw, sev::severity sv, const char* fmt, Args... args
+    )
+{
+    return detail::encode_entry<is_async, detail::fixed_width_encoding>(
+        fw.fe, sv, fmt, args...
+        );
+}
+//------------------------------------------------------------------------------
+#else //MAL_HAS_VARIADIC_TEMPLATES
+//------------------------------------------------------------------------------
 // todo: this function has to be beautified, but I don't want to add compile
 // time vectors or more complexity right now. This is written for compilers
 // without variadic template args.
@@ -158,8 +346,8 @@ bool new_entry(
 
     auto td = fe.get_timestamp_data();
     hdr     = ser::make_header_data (sv, fmt, arity, td.producer_timestamps);
-    if (hdr.has_tstamp) {                                                        //timestamping is actually slow! in my machine slows down the producers by a factor of 2
-        hdr.tstamp = get_ns_timestamp() - td.base;
+    if (hdr.has_tstamp) {                                                        //the clock call is slow (2x slower producers), the TSC read isn't
+        hdr.tstamp = get_entry_timestamp (td);
     }
     sync_point sync;
     if (!is_async) {
@@ -517,6 +705,8 @@ bool new_entry (frontend& fe, sev::severity sv, const char* fmt)
         );
 }
 //------------------------------------------------------------------------------
+#endif //MAL_HAS_VARIADIC_TEMPLATES
+//------------------------------------------------------------------------------
 } //namespace
 
 #endif /* MAL_LOG_INTERFACE_HPP_ */
@@ -136,6 +136,8 @@ inline bool silence_warnings() { return true; }
 
 #endif
 
+#ifndef MAL_CALL_SITE_REGISTRY
+
 #define MAL_LOG_PRIVATE(instance, async, severity_, ...)\
     MAL_LOG_IF_PRIVATE(\
         (MAL_FMT_STRING_CHECK (__VA_ARGS__)) &&\
@@ -144,6 +146,32 @@ inline bool silence_warnings() { return true; }
             instance, ::mal::sev::severity_, __VA_ARGS__\
             ))
 
+#elif !defined (MAL_WINDOWS) || (defined (_MSC_VER) && _MSC_VER > 1600)
+
+#include <mal_log/call_site.hpp>
+
+#define MAL_LOG_PRIVATE(instance, async, severity_, ...)\
+    ([&]() -> bool \
+    { \
+        static ::mal::call_site mal_call_site_private(\
+            MAL_GET_FMT_STR_PRIVATE (__VA_ARGS__),\
+            __FILE__,\
+            __LINE__,\
+            ::mal::sev::severity_\
+            );\
+        return MAL_LOG_IF_PRIVATE(\
+            (MAL_FMT_STRING_CHECK (__VA_ARGS__)) &&\
+            mal_call_site_private.enabled() &&\
+            (instance.can_log (::mal::sev::severity_)),\
+            ::mal::new_entry<async>(\
+                instance, ::mal::sev::severity_, __VA_ARGS__\
+                ));\
+    }.operator ()())
+
+#else
+    #error "MAL_CALL_SITE_REGISTRY needs static variables inside lambdas"
+#endif
+
 #define MAL_LOG_TO_STR_PRIVATE(a) #a
 #define MAL_LOG_FILELINE_CONCAT_PRIVATE(file, lin)\
     "(" file ":" MAL_LOG_TO_STR_PRIVATE (lin) ") "
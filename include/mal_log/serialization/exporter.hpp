@@ -226,6 +226,51 @@ public:
         return f;
     }
     //--------------------------------------------------------------------------
+    // Fixed width integers: all the bytes of the type are encoded, so the size
+    // and the field (but the sign bit) are compile time constants and the
+    // encoding has no branches. The importer reads them as any other integer.
+    //--------------------------------------------------------------------------
+    template <class T>
+    static typename enable_if_integral<T, uword>::type
+    fixed_bytes_required (T)
+    {
+        return sizeof (T) + sizeof (integral_field);
+    }
+    //--------------------------------------------------------------------------
+    static uword fixed_bytes_required (header_data h)
+    {
+        return sizeof (header_field) +
+               sizeof (const char*) +
+               (h.has_tstamp      ? sizeof h.tstamp : 0) +
+               (h.sync == nullptr ? 0 : sizeof h.sync);
+    }
+    //--------------------------------------------------------------------------
+    template <class T>
+    static typename enable_if_integral<T, integral_field>::type
+    get_fixed_field (T val)
+    {
+        typedef typename std::make_unsigned<T>::type U;
+        integral_field f = get_integral_field(
+            val, sizeof (T) + sizeof (integral_field), false
+            );
+        f.is_negative = std::is_signed<T>::value ?
+            (((U) val) >> (sizeof (T) * 8 - 1)) : 0;
+        return f;
+    }
+    //--------------------------------------------------------------------------
+    template <class T>
+    typename enable_if_integral<T, void>::type
+    do_export_fixed (T val, integral_field f)
+    {
+        typedef typename std::make_unsigned<T>::type U;
+        U v = (U) val;
+        if (std::is_signed<T>::value) {
+            v ^= (U) ((U) 0 - (v >> (sizeof (T) * 8 - 1)));                     //"prepare_negative" without branches
+        }
+        export_type (f);
+        encode_unsigned (v, sizeof (T));                                        //constant size: a plain store
+    }
+    //--------------------------------------------------------------------------
     void do_export (null_type, null_type) {}
     //--------------------------------------------------------------------------
     void do_export (header_data hd, header_field f)
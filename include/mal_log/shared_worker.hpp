@@ -0,0 +1,232 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_SHARED_WORKER_HPP_
+#define MAL_LOG_SHARED_WORKER_HPP_
+
+#include <cassert>
+#include <vector>
+#include <mal_log/util/system.hpp>
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/atomic.hpp>
+#include <mal_log/util/chrono.hpp>
+#include <mal_log/util/thread.hpp>
+#include <mal_log/util/thread_setup.hpp>
+#include <mal_log/util/pump_notifier.hpp>
+#include <mal_log/frontend.hpp>
+
+#if defined (MAL_UNIX_LIKE)
+    #include <cerrno>
+    #include <poll.h>
+#endif
+
+namespace mal {
+
+//------------------------------------------------------------------------------
+/* batch_entries: entries consumed from a frontend on each turn, multiplied by
+      its weight.
+
+   idle_timeout_ms: maximum sleep when all the frontends are idle, so their
+      timed tasks (flushes, rotation, severity files) still run. Keep it below
+      one second.
+
+   thread: CPU set, scheduling and name of the worker thread.
+*/
+//------------------------------------------------------------------------------
+struct shared_worker_cfg {
+    uword      batch_entries;
+    uword      idle_timeout_ms;
+    thread_cfg thread;
+};
+//------------------------------------------------------------------------------
+/* One thread consuming the entries of many frontends, instead of one logger
+   thread for each. Each frontend keeps its own files, severities and queue.
+   The frontends have to be initialized with "cfg::misc.manual_pump" and added
+   before "init". They are drained by turns, each one up to its weight times
+   "batch_entries" entries. The thread sleeps on all the pump notification
+   descriptors at once when there is nothing to do (POSIX, on Windows it polls
+   each millisecond).
+
+   "stop" (or the destructor) has to run before calling "on_termination" on
+   the frontends or destroying them.
+*/
+//------------------------------------------------------------------------------
+class shared_worker
+{
+public:
+    //--------------------------------------------------------------------------
+    shared_worker()
+    {
+        m_cfg.batch_entries   = 256;
+        m_cfg.idle_timeout_ms = 250;
+        thread_cfg_set_defaults (m_cfg.thread);
+        m_stop   = false;
+        m_active = false;
+    }
+    //--------------------------------------------------------------------------
+    ~shared_worker()
+    {
+        stop();
+    }
+    //--------------------------------------------------------------------------
+    shared_worker_cfg get_cfg() const
+    {
+        return m_cfg;
+    }
+    //--------------------------------------------------------------------------
+    bool add (frontend& fe, uword weight = 1)                                   //to be called before init
+    {
+        assert (!m_active);
+#if defined (MAL_UNIX_LIKE)
+        if (fe.pump_fd() < 0) {
+            assert (false && "the frontend isn't in manual pump mode");
+            return false;
+        }
+#endif
+        if (m_active || weight == 0) {
+            return false;
+        }
+        source s;
+        s.fe     = &fe;
+        s.weight = weight;
+        m_sources.push_back (s);
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    bool init (const shared_worker_cfg& c)
+    {
+        assert (!m_active);
+        if (m_active || c.batch_entries == 0 || m_sources.empty()) {
+            return false;
+        }
+        m_cfg  = c;
+        m_stop = false;
+        if (!m_wakeup.init()) {
+            return false;
+        }
+#if defined (MAL_UNIX_LIKE)
+        m_fds.clear();
+        pollfd p;
+        p.events  = POLLIN;
+        p.revents = 0;
+        p.fd      = m_wakeup.fd();
+        m_fds.push_back (p);
+        for (uword i = 0; i < m_sources.size(); ++i) {
+            p.fd = m_sources[i].fe->pump_fd();
+            m_fds.push_back (p);
+        }
+#endif
+        try {
+            m_thread = th::thread ([this]() { this->thread(); });
+        }
+        catch (...) {
+            m_wakeup.close();
+            return false;
+        }
+        m_active = true;
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    void stop()                                                                 //consumes what is left before returning
+    {
+        if (!m_active) {
+            return;
+        }
+        m_stop.store (true, mo_relaxed);
+        m_wakeup.signal();
+        m_thread.join();
+        m_wakeup.close();
+        m_active = false;
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    struct source {
+        frontend* fe;
+        uword     weight;
+    };
+    //--------------------------------------------------------------------------
+    uword drain_turn()
+    {
+        uword count = 0;
+        for (uword i = 0; i < m_sources.size(); ++i) {
+            source& s = m_sources[i];
+            count    += s.fe->pump (s.weight * m_cfg.batch_entries, 0);
+        }
+        return count;
+    }
+    //--------------------------------------------------------------------------
+    void wait()
+    {
+#if defined (MAL_UNIX_LIKE)
+        int r;
+        do {
+            r = ::poll (&m_fds[0], m_fds.size(), (int) m_cfg.idle_timeout_ms);
+        }
+        while (r < 0 && errno == EINTR);
+#else
+        th::this_thread::sleep_for (ch::milliseconds (1));
+#endif
+    }
+    //--------------------------------------------------------------------------
+    void thread()
+    {
+        setup_this_thread (m_cfg.thread);
+        while (!m_stop.load (mo_relaxed)) {
+            if (drain_turn() == 0) {
+                wait();
+            }
+        }
+        while (drain_turn()) {}
+    }
+    //--------------------------------------------------------------------------
+    shared_worker (const shared_worker&);
+    shared_worker& operator= (const shared_worker&);
+
+    shared_worker_cfg   m_cfg;
+    std::vector<source> m_sources;
+#if defined (MAL_UNIX_LIKE)
+    std::vector<pollfd> m_fds;
+#endif
+    pump_notifier       m_wakeup;
+    th::thread          m_thread;
+    atomic_bool         m_stop;
+    bool                m_active;
+};
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_SHARED_WORKER_HPP_ */
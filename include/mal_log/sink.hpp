@@ -0,0 +1,158 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_SINK_HPP_
+#define MAL_LOG_SINK_HPP_
+
+#include <memory>
+#include <vector>
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/atomic.hpp>
+#include <mal_log/frontend_types.hpp>
+#include <mal_log/util/thread_setup.hpp>
+
+namespace mal {
+
+//------------------------------------------------------------------------------
+/* A contiguous run of already formatted log lines (each one ended in '\n')
+   that passed the sink severity filter. "min_sev" and "max_sev" are the lowest
+   and highest severity of the lines inside. "flush" is set when the last line
+   asked for a flush (critical severity and above).
+*/
+//------------------------------------------------------------------------------
+struct sink_span {
+    const char*   data;
+    uword         size;
+    uword         entries;
+    sev::severity min_sev;
+    sev::severity max_sev;
+    bool          flush;
+};
+//------------------------------------------------------------------------------
+/* User defined log destination. Register it on "cfg::sinks" before
+   initializing the backend.
+
+   "write" is called once per rendered batch (not once per line) with all the
+   spans that passed the severity filter, so a sink can e.g. do a single
+   "writev". The span memory is only valid during the call. The calls come
+   always from the same logger thread (the I/O thread when enabled), so no
+   locking is required inside the sink, but they shouldn't block for long:
+   a blocked sink stalls the whole logger.
+
+   "flush" is called after writing spans containing a flush request and
+   periodically when the logger is idle. "close" is called once when the
+   logger stops, after the last write.
+
+   "split_by_severity" makes each span contain lines of a single severity
+   (min_sev == max_sev), for destinations that tag each line, at the cost of
+   shorter spans.
+
+   The severity can be changed at any moment, but use
+   "frontend::set_sink_severity" for registered sinks, as the frontend caches
+   the minimum severity of all the outputs.
+*/
+//------------------------------------------------------------------------------
+class sink
+{
+public:
+    //--------------------------------------------------------------------------
+    sink (sev::severity s = sev::warning) : m_sev (s) {}
+    //--------------------------------------------------------------------------
+    virtual ~sink() {}
+    //--------------------------------------------------------------------------
+    virtual void write (const sink_span* spans, uword count) = 0;
+    //--------------------------------------------------------------------------
+    virtual void flush() {}
+    //--------------------------------------------------------------------------
+    virtual void close() {}
+    //--------------------------------------------------------------------------
+    virtual bool split_by_severity() const
+    {
+        return false;
+    }
+    //--------------------------------------------------------------------------
+    sev::severity severity() const
+    {
+        return m_sev;
+    }
+    //--------------------------------------------------------------------------
+    void set_severity (sev::severity s)
+    {
+        m_sev = s;
+    }
+    //--------------------------------------------------------------------------
+private:
+    sink (const sink&);
+    sink& operator= (const sink&);
+
+    mo_relaxed_atomic<sev::severity> m_sev;
+};
+//------------------------------------------------------------------------------
+/* drop: when all the buffers are in flight the batch is discarded and counted.
+      A line with the amount of dropped entries is written to the sink once it
+      has room again.
+   block: when all the buffers are in flight the logger waits (and so do all
+      the other sinks).
+*/
+//------------------------------------------------------------------------------
+struct sink_overflow {
+    enum policy {
+        drop  = 0,
+        block = 1,
+    };
+};
+//------------------------------------------------------------------------------
+/* Queue in front of a sink, see "async_sink.hpp".
+
+   buffer_count: batches that can be queued to the sink. 0 = no queue, the
+      sink is written from the logger thread.
+
+   thread: CPU set, scheduling and name of the queue thread. A zeroed struct
+      leaves the thread as created. On the console queue a zeroed struct means
+      "cfg::helper_threads" and the name gets ".stderr" or ".stdout" appended.
+*/
+//------------------------------------------------------------------------------
+struct sink_queue_cfg {
+    uword                 buffer_count;
+    sink_overflow::policy overflow;
+    thread_cfg            thread;
+};
+//------------------------------------------------------------------------------
+typedef std::vector<std::shared_ptr<sink> > sink_list;
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_SINK_HPP_ */
@@ -37,9 +37,31 @@ either expressed or implied, of Rafael Gago Castano.
 #ifndef MAL_LOG_TIMESTAMP_HPP_
 #define MAL_LOG_TIMESTAMP_HPP_
 
+#include <mal_log/util/system.hpp>
 #include <mal_log/util/integer.hpp>
 #include <mal_log/util/chrono.hpp>
 
+#if defined (__linux__)
+    #include <time.h>
+#endif
+
+// MAL_HAS_TSC: "get_tsc_timestamp" reads a cycle counter: the TSC on x86 and
+//     the virtual counter on ARMv8. Define MAL_NO_TSC to disable it.
+
+#if !defined (MAL_NO_TSC)
+    #if defined (_MSC_VER) && (defined (_M_X64) || defined (_M_IX86))
+        #define MAL_HAS_TSC 1
+        #include <intrin.h>
+    #elif (defined (__GNUC__) || defined (__clang__)) && \
+        (defined (__x86_64__) || defined (__i386__))
+        #define MAL_HAS_TSC 1
+        #include <x86intrin.h>
+        #include <cpuid.h>
+    #elif (defined (__GNUC__) || defined (__clang__)) && defined (__aarch64__)
+        #define MAL_HAS_TSC 1
+    #endif
+#endif
+
 namespace mal {
 //--------------------------------------------------------------------------
 inline u64 get_ns_timestamp()
@@ -49,6 +71,63 @@ inline u64 get_ns_timestamp()
             ).count();
 }
 //--------------------------------------------------------------------------
+inline u64 get_coarse_ns_timestamp()                                            //same epoch as "get_ns_timestamp" isn't guaranteed
+{
+#if defined (__linux__) && defined (CLOCK_MONOTONIC_COARSE)
+    timespec t;
+    clock_gettime (CLOCK_MONOTONIC_COARSE, &t);
+    return ((u64) t.tv_sec * 1000000000) + (u64) t.tv_nsec;
+#else
+    return get_ns_timestamp();
+#endif
+}
+//--------------------------------------------------------------------------
+inline u64 get_realtime_ns_timestamp()                                          //since the epoch
+{
+    return ch::duration_cast<ch::nanoseconds>(
+            ch::system_clock::now().time_since_epoch()
+            ).count();
+}
+//--------------------------------------------------------------------------
+inline u64 get_tsc_timestamp()                                                  //raw ticks, only meaningful if "tsc_is_invariant"
+{
+#if !defined (MAL_HAS_TSC)
+    return get_ns_timestamp();
+#elif defined (__aarch64__)
+    u64 v;
+    __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (v));
+    return v;
+#else
+    return __rdtsc();
+#endif
+}
+//--------------------------------------------------------------------------
+inline bool tsc_is_invariant()                                                  //constant rate, not stopped on sleep states
+{
+#if !defined (MAL_HAS_TSC)
+    return false;
+#elif defined (__aarch64__)
+    return true;                                                                //the generic timer has a fixed frequency
+#elif defined (_MSC_VER)
+    int r[4];
+    __cpuid (r, 0x80000000);
+    if ((unsigned) r[0] < 0x80000007u) {
+        return false;
+    }
+    __cpuid (r, 0x80000007);
+    return (r[3] & (1 << 8)) != 0;
+#else
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    if (__get_cpuid_max (0x80000000u, nullptr) < 0x80000007u) {
+        return false;
+    }
+    if (!__get_cpuid (0x80000007u, &a, &b, &c, &d)) {
+        return false;
+    }
+    return (d & (1u << 8)) != 0;
+#endif
+}
+//--------------------------------------------------------------------------
 inline bool timestamp_is_expired (u64 now, u64 deadline)
 {
     return (i64) (deadline - now) <= 0;
@@ -0,0 +1,155 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_PUMP_NOTIFIER_HPP_
+#define MAL_LOG_PUMP_NOTIFIER_HPP_
+
+#include <mal_log/util/system.hpp>
+#include <mal_log/util/integer.hpp>
+
+#if defined (MAL_UNIX_LIKE)
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #if defined (__linux__)
+        #include <sys/eventfd.h>
+    #endif
+#endif
+
+namespace mal {
+
+//------------------------------------------------------------------------------
+// A file descriptor that any thread can make readable to wake up a "poll"
+// loop: the manual pump notification and the "shared_worker" stop signal. An
+// eventfd on Linux, a non-blocking pipe on other POSIX systems. Not available
+// on Windows ("fd" returns -1).
+//------------------------------------------------------------------------------
+class pump_notifier
+{
+public:
+    //--------------------------------------------------------------------------
+    pump_notifier()
+    {
+        m_rfd = m_wfd = -1;
+    }
+    //--------------------------------------------------------------------------
+    ~pump_notifier()
+    {
+        close();
+    }
+    //--------------------------------------------------------------------------
+    bool init()
+    {
+        close();
+#if defined (__linux__)
+        m_rfd = m_wfd = ::eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+        return m_rfd >= 0;
+#elif defined (MAL_UNIX_LIKE)
+        int p[2];
+        if (::pipe (p) != 0) {
+            return false;
+        }
+        for (int i = 0; i < 2; ++i) {
+            ::fcntl (p[i], F_SETFL, ::fcntl (p[i], F_GETFL) | O_NONBLOCK);
+            ::fcntl (p[i], F_SETFD, FD_CLOEXEC);
+        }
+        m_rfd = p[0];
+        m_wfd = p[1];
+        return true;
+#else
+        return true;
+#endif
+    }
+    //--------------------------------------------------------------------------
+    int fd() const
+    {
+        return m_rfd;
+    }
+    //--------------------------------------------------------------------------
+    void signal()                                                               //any thread
+    {
+#if defined (MAL_UNIX_LIKE)
+        if (m_wfd < 0) {
+            return;
+        }
+        u64 one = 1;                                                            //eventfd requires 8 bytes
+        ssize_t r;
+        do {
+            r = ::write (m_wfd, &one, sizeof one);
+        }
+        while (r < 0 && errno == EINTR);                                        //EAGAIN: already readable
+#endif
+    }
+    //--------------------------------------------------------------------------
+    void clear()                                                                //reader thread
+    {
+#if defined (MAL_UNIX_LIKE)
+        if (m_rfd < 0) {
+            return;
+        }
+        u8 buff[64];
+        ssize_t r;
+        do {
+            r = ::read (m_rfd, buff, sizeof buff);
+        }
+        while (r > 0 || (r < 0 && errno == EINTR));
+#endif
+    }
+    //--------------------------------------------------------------------------
+    void close()
+    {
+#if defined (MAL_UNIX_LIKE)
+        if (m_wfd >= 0 && m_wfd != m_rfd) {
+            ::close (m_wfd);
+        }
+        if (m_rfd >= 0) {
+            ::close (m_rfd);
+        }
+#endif
+        m_rfd = m_wfd = -1;
+    }
+    //--------------------------------------------------------------------------
+private:
+    pump_notifier (const pump_notifier&);
+    pump_notifier& operator= (const pump_notifier&);
+
+    int m_rfd;
+    int m_wfd;
+};
+//------------------------------------------------------------------------------
+} //namespace
+
+#endif /* MAL_LOG_PUMP_NOTIFIER_HPP_ */
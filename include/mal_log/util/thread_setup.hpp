@@ -0,0 +1,177 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_THREAD_SETUP_HPP_
+#define MAL_LOG_THREAD_SETUP_HPP_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <mal_log/util/system.hpp>
+#include <mal_log/util/integer.hpp>
+
+#if defined (MAL_UNIX_LIKE)
+    #include <pthread.h>
+    #include <sched.h>
+    #if defined (__linux__)
+        #include <sys/resource.h>
+        #include <sys/syscall.h>
+        #include <unistd.h>
+    #endif
+#elif defined (MAL_WINDOWS)
+    #include <windows.h>
+#endif
+
+namespace mal {
+//------------------------------------------------------------------------------
+struct sched_policy {
+    enum type {
+        inherit = 0,
+        other   = 1,
+        fifo    = 2,
+    };
+};
+//------------------------------------------------------------------------------
+/* cpus: CPUs the thread can run on. Empty = inherited from the creator.
+
+   policy: "inherit": nothing is changed. "other": SCHED_OTHER with "priority"
+      as the nice value (Linux only, per thread). "fifo": SCHED_FIFO with
+      "priority" as the realtime priority (1-99), usually requires privileges.
+      On Windows "fifo" maps to THREAD_PRIORITY_TIME_CRITICAL.
+
+   name: thread name as seen by debuggers and "top -H". Linux truncates it to
+      15 characters. Empty = unnamed.
+*/
+//------------------------------------------------------------------------------
+struct thread_cfg {
+    std::vector<uword> cpus;
+    sched_policy::type policy;
+    int                priority;
+    std::string        name;
+};
+//------------------------------------------------------------------------------
+inline void thread_cfg_set_defaults (thread_cfg& c)
+{
+    c.cpus.clear();
+    c.policy   = sched_policy::inherit;
+    c.priority = 0;
+    c.name.clear();
+}
+//------------------------------------------------------------------------------
+inline bool thread_cfg_is_default (const thread_cfg& c)                         //"priority" is unused with "inherit"
+{
+    return c.cpus.empty() && c.policy == sched_policy::inherit &&
+        c.name.empty();
+}
+//------------------------------------------------------------------------------
+inline bool setup_this_thread (const thread_cfg& c)                             //to be run from the thread to set up. Failures aren't fatal
+{
+    bool ok = true;
+#if defined (MAL_UNIX_LIKE)
+    #if defined (__linux__)
+    if (!c.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO (&set);
+        for (uword i = 0; i < c.cpus.size(); ++i) {
+            if (c.cpus[i] < CPU_SETSIZE) {
+                CPU_SET (c.cpus[i], &set);
+            }
+        }
+        ok &= pthread_setaffinity_np (pthread_self(), sizeof set, &set) == 0;
+    }
+    #endif
+    sched_param p;
+    switch (c.policy) {
+    case sched_policy::other:
+        p.sched_priority = 0;
+        ok &= pthread_setschedparam (pthread_self(), SCHED_OTHER, &p) == 0;
+    #if defined (__linux__)
+        ok &= setpriority(
+            PRIO_PROCESS, (id_t) syscall (SYS_gettid), c.priority
+            ) == 0;
+    #endif
+        break;
+    case sched_policy::fifo:
+        p.sched_priority = c.priority;
+        ok &= pthread_setschedparam (pthread_self(), SCHED_FIFO, &p) == 0;
+        break;
+    default:
+        break;
+    }
+    if (!c.name.empty()) {
+    #if defined (__linux__)
+        std::string n = c.name.substr (0, 15);
+        ok &= pthread_setname_np (pthread_self(), n.c_str()) == 0;
+    #elif defined (__APPLE__)
+        ok &= pthread_setname_np (c.name.c_str()) == 0;
+    #endif
+    }
+#elif defined (MAL_WINDOWS)
+    if (!c.cpus.empty()) {
+        DWORD_PTR mask = 0;
+        for (uword i = 0; i < c.cpus.size(); ++i) {
+            if (c.cpus[i] < sizeof mask * 8) {
+                mask |= ((DWORD_PTR) 1) << c.cpus[i];
+            }
+        }
+        ok &= SetThreadAffinityMask (GetCurrentThread(), mask) != 0;
+    }
+    if (c.policy == sched_policy::fifo) {
+        ok &= SetThreadPriority(
+            GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL
+            ) != 0;
+    }
+#endif
+    if (!ok) {
+        std::cerr << "[logger] unable to fully apply the thread cfg of \""
+                  << c.name << "\"\n";
+    }
+    return ok;
+}
+//------------------------------------------------------------------------------
+inline thread_cfg thread_cfg_with_role (thread_cfg c, const char* role)        //"name" + "." + "role", "name" stays empty if it was
+{
+    if (!c.name.empty()) {
+        c.name += '.';
+        c.name += role;
+    }
+    return c;
+}
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_THREAD_SETUP_HPP_ */
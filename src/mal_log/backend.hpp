@@ -41,7 +41,7 @@ either expressed or implied, of Rafael Gago Castano.
 #include <cstdio>
 #include <functional>
 #include <new>
-#include <ostream>
+#include <iostream>
 #include <cstdlib>
 
 #include <mal_log/util/integer.hpp>
@@ -54,6 +54,16 @@ either expressed or implied, of Rafael Gago Castano.
 #include <mal_log/output.hpp>
 #include <mal_log/frontend.hpp>
 #include <mal_log/log_writer.hpp>
+#include <mal_log/render_buffer.hpp>
+#include <mal_log/formatting_pool.hpp>
+#include <mal_log/io_stage.hpp>
+#include <mal_log/slice_compressor.hpp>
+#include <mal_log/slice_preopener.hpp>
+#include <mal_log/past_files_scanner.hpp>
+#include <mal_log/tsc_clock.hpp>
+#include <mal_log/util/pump_notifier.hpp>
+#include <mal_log/tcp_sink.hpp>
+#include <mal_log/async_to_sync.hpp>
 #include <mal_log/queue.hpp>
 #include <mal_log/cfg.hpp>
 #include <mal_log/log_file_register.hpp>
@@ -61,8 +71,6 @@ either expressed or implied, of Rafael Gago Castano.
 
 namespace mal {
 
-class async_to_sync;
-
 //------------------------------------------------------------------------------
 class backend_impl
 {
@@ -76,6 +84,16 @@ public:
         m_status             = constructed;
         m_alloc_fault        = 0;
         m_on_error_avoidance = false;
+        m_sync               = nullptr;
+        m_unsynced           = false;
+        m_preopen_bytes      = 0;
+        m_next_calib         = 0;
+        m_next_anchor        = 0;
+        m_next_sev_check     = 0;
+        m_alloc_fault_seen   = 0;
+        m_consumed           = 0;
+        m_manual_pump        = false;
+        m_pump_armed         = false;
         set_cfg_defaults (config);
     }
     //--------------------------------------------------------------------------
@@ -108,6 +126,16 @@ public:
     void push_entry (const queue_prepared& entry)
     {
         m_fifo.bounded_push_commit (entry);
+        if (m_manual_pump) {
+            /* pairs with the fence on "pump": either the pump sees this entry
+               or this sees the pump armed */
+            at::atomic_thread_fence (mo_seq_cst);
+            if (m_pump_armed.load (mo_relaxed) &&
+                m_pump_armed.exchange (false, mo_relaxed)
+                ) {
+                m_notifier.signal();
+            }
+        }
     }
     //--------------------------------------------------------------------------
     void set_file_severity (sev::severity s)
@@ -125,6 +153,11 @@ public:
         return m_out.min_severity();
     }
     //--------------------------------------------------------------------------
+    const timestamp_data& timestamps() const
+    {
+        return m_timestamps;
+    }
+    //--------------------------------------------------------------------------
     bool init(
         const cfg&            c,
         async_to_sync&        sync,
@@ -132,6 +165,18 @@ public:
         const sev_update_evt& su
         )
     {
+        past_executions_file_list discovered;
+        bool discover = c.file.rotation.discover_past_files &&
+            c.file.rotation.file_count &&
+            c.file.rotation.past_files.empty();
+        if (discover) {
+            /* before "validate_cfg" writes its test file on the folder */
+            discover = !past_files_scanner::load_state(
+                discovered,
+                with_separator (c.file.out_folder),
+                c.file.name_prefix
+                );
+        }
         if (!validate_cfg (c)) { return false; }
 
         uword exp = constructed;
@@ -140,33 +185,152 @@ public:
             assert (false && "log: already initialized");
             return false;
         }
+        const cfg rollback_cfg = config;
         uword bsz     = c.queue.bounded_q_block_size;
         uword esz     = c.queue.bounded_q_entry_size;
         uword entries = (bsz && esz) ? (bsz / esz) :  0;
         if (!m_fifo.init (bsz, entries, c.queue.can_use_heap_q)) {
             std::cerr << "[logger] queue initialization failed\n";
             assert (false && "queue initialization failed");
+            init_rollback (rollback_cfg);
+            return false;
+        }
+        if (c.misc.manual_pump && !m_notifier.init()) {
+            std::cerr << "[logger] unable to create the pump notification fd\n";
+            init_rollback (rollback_cfg);
+            return false;
+        }
+        if (!m_out.set_file_compression (c.file.compression)) {
+            std::cerr << "[logger] unable to allocate the compression buffers\n";
+            init_rollback (rollback_cfg);
+            return false;
+        }
+        if (!m_out.set_console_queue (c.console_queue, c.helper_threads)) {
+            std::cerr << "[logger] unable to launch the console threads\n";
+            init_rollback (rollback_cfg);
+            return false;
+        }
+        if (c.file.compress_closed_slices && !m_compressor.init()) {
+            std::cerr << "[logger] unable to allocate the compression buffers\n";
+            init_rollback (rollback_cfg);
             return false;
         }
+        std::string suffix = c.file.name_suffix;
+        if (c.file.compression == file_compression::lz4) {
+            suffix += lz4::file_extension;
+        }
+        if (discover) {
+            if (!past_files_scanner::scan(
+                    discovered,
+                    with_separator (c.file.out_folder),
+                    c.file.name_prefix,
+                    suffix,
+                    c.file.compress_closed_slices ? lz4::file_extension : ""
+                    )) {
+                std::cerr << "[logger] unable to list the past files\n";
+            }
+        }
         if (!m_files_register.init(
                 c.file.rotation.file_count + c.file.rotation.delayed_file_count,
                 c.file.out_folder,
                 c.file.name_prefix,
-                c.file.name_suffix,
-                c.file.rotation.past_files
+                suffix,
+                discovered.size() ? discovered : c.file.rotation.past_files,
+                c.file.compress_closed_slices ?
+                    sizeof lz4::file_extension - 1 : 0
                 )) {
-            m_fifo.clear();
+            init_rollback (rollback_cfg);
             return false;
         }
-        auto rollback_cfg = config;
         set_cfg (c);
 
-        m_writer.set_synchronizer (sync);
-        m_writer.set_timestamp_base (timestamp_base);
+        m_sync = &sync;
+        init_clock (timestamp_base);
         m_files_register.set_timestamp_base (timestamp_base);
 
+        m_pool.set_thread_cfg(
+            thread_cfg_with_role (config.helper_threads, "fmt")
+            );
+        m_preopen.set_thread_cfg(
+            thread_cfg_with_role (config.helper_threads, "slice")
+            );
+        m_io.set_thread_cfg (thread_cfg_with_role (config.helper_threads, "io"));
+#if defined (MAL_UNIX_LIKE)
+        m_tcp.set_thread_cfg(
+            thread_cfg_with_role (config.helper_threads, "tcp")
+            );
+#endif
+        if (config.formatting.workers && !m_pool.init(
+                config.formatting.workers,
+                config.formatting.batch_entries,
+                m_fifo,
+                m_writer
+                )) {
+            std::cerr << "[logger] unable to launch the formatting threads\n";
+            init_rollback (rollback_cfg);
+            return false;
+        }
+        if (config.file.preopen_pct) {
+            if (!m_preopen.init(
+                    config.file.compression == file_compression::lz4
+                    )) {
+                std::cerr << "[logger] unable to launch the slicing thread\n";
+                init_rollback (rollback_cfg);
+                return false;
+            }
+            m_files_register.set_eraser ([this](const char* f) {
+                /* the compressor can't notice a deferred deletion */
+                this->m_compressor.forget (f);
+                this->m_preopen.erase (f);
+            });
+            m_preopen_bytes = (u64) config.file.aprox_size *
+                config.file.preopen_pct / 100;
+        }
+#if defined (MAL_UNIX_LIKE)
+        if (config.tcp.host.size()) {
+            if (!m_tcp.init(
+                    config.tcp, config.file.out_folder, timestamp_base
+                    )) {
+                std::cerr << "[logger] unable to start the TCP sink\n";
+                init_rollback (rollback_cfg);
+                return false;
+            }
+            m_out.add_sink (m_tcp);
+        }
+#endif
+        idle_rotate_if();
+        change_current_filename();
+        if (rotates() && config.file.rotation.discover_past_files) {
+            m_files_register.rotation_list_keep_newer(
+                config.file.rotation.file_count +
+                config.file.rotation.delayed_file_count - 1
+                );
+            m_files_register.push_current_filename_to_rotation_list();
+        }
+        m_next_flush  = get_ns_timestamp() + (1 * 1000 * 1000 * 1000);
+        m_next_sync   = get_ns_timestamp() + sync_period_ns();
+        m_next_calib  = get_ns_timestamp() + (1 * 1000 * 1000 * 1000);
+        m_next_anchor = get_ns_timestamp();
+        m_unsynced    = false;
+
+        if (config.io.dedicated_thread && !m_io.init(
+                config.io.buffer_count,
+                [this](render_buffer& b) { this->write_rendered (b); },
+                [this]() { return this->io_idle_tasks(); }
+                )) {
+            std::cerr << "[logger] unable to launch the I/O thread\n";
+            init_rollback (rollback_cfg);
+            return false;
+        }
+
+        m_sev_evt     = su;
+        m_manual_pump = config.misc.manual_pump;
+        if (m_manual_pump) {
+            m_pump_armed.store (true, mo_relaxed);                              //nothing consumed yet
+            consumer_start();
+            return true;
+        }
         m_status.store (initialized, mo_release);                               // I guess that all Kernels do this for me when launching a thread, just being on the safe side in case is not true
-        m_sev_evt    = su;
         m_log_thread = th::thread ([this](){ this->thread(); });
 
         while (m_status.load (mo_relaxed) == initialized) {
@@ -176,7 +340,8 @@ public:
             return true;
         }
         else {
-            set_cfg (rollback_cfg);
+            m_log_thread.join();
+            init_rollback (rollback_cfg);
             return false;
         }
     }
@@ -186,10 +351,67 @@ public:
         m_fifo.block_producers();
         uword exp = running;
         if (m_status.compare_exchange_strong (exp, terminating, mo_relaxed)) {
-            m_log_thread.join();
+            if (m_manual_pump) {
+                while (consumer_step()) {}
+                consumer_stop();
+            }
+            else {
+                m_log_thread.join();
+            }
         }
     }
     //--------------------------------------------------------------------------
+    uword pump (uword max_entries, u64 max_ns)                                  //manual pump mode only, from one thread at a time
+    {
+        if (!m_manual_pump || m_status.load (mo_relaxed) != running) {
+            return 0;
+        }
+        m_notifier.clear();
+        m_pump_armed.store (false, mo_relaxed);
+        u64   deadline = get_ns_timestamp() + max_ns;
+        u64   start    = m_consumed;
+        uword steps    = 0;
+        bool  pending  = true;
+        while (true) {
+            if (max_entries && (m_consumed - start) >= max_entries) {
+                break;
+            }
+            if (max_ns && (steps % 32) == 0 && steps &&
+                timestamp_is_expired (get_ns_timestamp(), deadline)
+                ) {
+                break;
+            }
+            if (consumer_step()) {
+                ++steps;
+                continue;
+            }
+            if (m_pump_armed.load (mo_relaxed)) {
+                pending = false;
+                break;
+            }
+            /* empty: arm the notification and look again, a producer may
+               have pushed in between without seeing it armed */
+            m_pump_armed.store (true, mo_relaxed);
+            at::atomic_thread_fence (mo_seq_cst);
+        }
+        if (pending && !m_pool.active()) {
+            deliver (m_render);                                                 //the budget ran out, don't keep the rendered entries
+        }
+        if (!m_io.active() && io_idle_tasks()) {
+            pending = true;
+        }
+        severity_check_if (get_ns_timestamp());
+        if (pending) {
+            m_notifier.signal();                                                //come back soon
+        }
+        return (uword) (m_consumed - start);
+    }
+    //--------------------------------------------------------------------------
+    int pump_fd() const
+    {
+        return m_notifier.fd();
+    }
+    //--------------------------------------------------------------------------
     bool prints_timestamp()
     {
         return m_writer.prints_timestamp;
@@ -211,7 +433,14 @@ private:
         c.file.name_suffix         = ".log";
         c.file.rotation.file_count = 0;
         c.file.rotation.delayed_file_count     = 0;
+        c.file.rotation.recycle_files          = false;
+        c.file.rotation.discover_past_files    = false;
         c.file.erase_and_retry_on_fatal_errors = false;
+        c.file.compression                     = file_compression::none;
+        c.file.compress_closed_slices          = false;
+        c.file.durability                      = file_durability::flush;
+        c.file.sync_period_ms                  = 1000;
+        c.file.preopen_pct                     = 0;
 
         c.consumer_backoff = m_wait.cfg;
 
@@ -222,7 +451,29 @@ private:
         c.producer_backoff.short_sleep_end     = 32;
         c.producer_backoff.long_sleep_ns       = 100000;
 
-        c.misc.producer_timestamp = false;
+        c.misc.producer_timestamp    = false;
+        c.misc.clock                 = clock_source::steady;
+        c.misc.clock_anchor_period_s = 0;
+        c.misc.manual_pump           = false;
+
+        c.formatting.workers       = 0;
+        c.formatting.batch_entries = 256;
+
+        c.io.dedicated_thread = false;
+        c.io.buffer_count     = 4;
+        c.io.buffer_bytes     = 64 * 1024;
+
+        c.console_queue.buffer_count = 0;
+        c.console_queue.overflow     = sink_overflow::drop;
+        thread_cfg_set_defaults (c.console_queue.thread);
+        thread_cfg_set_defaults (c.consumer_thread);
+        thread_cfg_set_defaults (c.helper_threads);
+
+        c.tcp.severity         = sev::warning;
+        c.tcp.memory_bytes     = 4 * 1024 * 1024;
+        c.tcp.spill_prefix     = "spill.";
+        c.tcp.spill_file_bytes = 16 * 1024 * 1024;
+        c.tcp.spill_max_files  = 64;
     }
     //--------------------------------------------------------------------------
     void set_cfg (const cfg& c)
@@ -231,12 +482,38 @@ private:
         m_writer.prints_severity  = config.display.show_severity;
         m_writer.prints_timestamp = config.display.show_timestamp;
         m_wait.cfg                = c.consumer_backoff;
+        m_out.set_sinks (config.sinks);
+        m_out.set_durability (config.file.durability);
+        m_out.set_file_preallocation(
+            recycles() ? (u64) config.file.aprox_size : 0
+            );
         /* corrections */
         if (config.queue.can_use_heap_q) {
             config.queue.bounded_q_blocking_sev = sev::off;
         }
     }
     //--------------------------------------------------------------------------
+    void init_rollback (const cfg& rollback_cfg)                                //undoes what a failed "init" did, a later "init" can be retried
+    {
+        m_pool.stop();
+        m_io.stop();
+        stop_preopener();                                                       //resets the eraser too
+        m_preopen_bytes = 0;
+#if defined (MAL_UNIX_LIKE)
+        m_out.remove_sink (m_tcp);                                              //a retried "init" adds it again
+        m_tcp.close();
+#endif
+        m_out.reset_console_queue();
+        m_out.file_close();
+        m_out.set_file_compression (file_compression::none);                    //frees the buffers
+        m_compressor.free();
+        m_notifier.close();
+        m_fifo.clear();
+        m_sync = nullptr;
+        set_cfg (rollback_cfg);
+        m_status.store (constructed, mo_relaxed);
+    }
+    //--------------------------------------------------------------------------
     bool validate_cfg (const cfg& c)
     {
         uword bsz = c.queue.bounded_q_block_size;
@@ -281,6 +558,95 @@ private:
             assert (false && "won't be able to rotate a single file");
             return false;
         }
+        if (c.file.compress_closed_slices &&
+            (c.file.aprox_size == 0 ||
+                c.file.compression != file_compression::none)
+            ) {
+            std::cerr << "[logger] compressing closed slices requires slicing "
+                         "uncompressed files\n";
+            assert (false && "invalid closed slice compression cfg");
+            return false;
+        }
+        if (!valid_thread_cfg (c.consumer_thread) ||
+            !valid_thread_cfg (c.helper_threads)
+            ) {
+            std::cerr << "[logger] invalid thread cfg\n";
+            assert (false && "invalid thread cfg");
+            return false;
+        }
+        if (c.misc.clock > clock_source::tsc) {
+            std::cerr << "[logger] invalid clock source\n";
+            assert (false && "invalid clock source");
+            return false;
+        }
+        if (c.file.durability > file_durability::sync_acks) {
+            std::cerr << "[logger] invalid durability level\n";
+            assert (false && "invalid durability level");
+            return false;
+        }
+        if (c.file.durability >= file_durability::fdatasync &&
+            c.file.sync_period_ms == 0
+            ) {
+            std::cerr << "[logger] the fdatasync period can't be 0\n";
+            assert (false && "the fdatasync period can't be 0");
+            return false;
+        }
+        if (c.file.rotation.recycle_files &&
+            (c.file.rotation.file_count == 0 ||
+                c.file.compress_closed_slices ||
+                c.file.preopen_pct)
+            ) {
+            std::cerr << "[logger] recycling files requires rotation and is "
+                         "incompatible with compressing closed slices and "
+                         "preopening\n";
+            assert (false && "invalid file recycling cfg");
+            return false;
+        }
+#if !defined (MAL_UNIX_LIKE)
+        if (c.file.rotation.discover_past_files) {
+            std::cerr << "[logger] past file discovery is POSIX only\n";
+            assert (false && "past file discovery is POSIX only");
+            return false;
+        }
+#endif
+        if (c.file.preopen_pct &&
+            (c.file.aprox_size == 0 || c.file.preopen_pct > 100)
+            ) {
+            std::cerr << "[logger] preopening slices requires slicing and a "
+                         "percentage up to 100\n";
+            assert (false && "invalid slice preopening cfg");
+            return false;
+        }
+        if (c.formatting.workers && !c.formatting.batch_entries) {
+            std::cerr << "[logger] formatting batches can't be empty\n";
+            assert (false && "formatting batches can't be empty");
+            return false;
+        }
+        if (c.io.dedicated_thread && !c.io.buffer_count) {
+            std::cerr << "[logger] the I/O thread requires buffers\n";
+            assert (false && "the I/O thread requires buffers");
+            return false;
+        }
+        for (auto it = c.sinks.begin(); it != c.sinks.end(); ++it) {
+            if (!*it) {
+                std::cerr << "[logger] null sink\n";
+                assert (false && "null sink");
+                return false;
+            }
+        }
+        if (c.tcp.host.size()) {
+#if defined (MAL_UNIX_LIKE)
+            if (c.tcp.port.empty() || !c.tcp.memory_bytes) {
+                std::cerr << "[logger] invalid TCP sink cfg\n";
+                assert (false && "invalid TCP sink cfg");
+                return false;
+            }
+#else
+            std::cerr << "[logger] the TCP sink is not available\n";
+            assert (false && "the TCP sink is not available");
+            return false;
+#endif
+        }
         if (c.file.out_folder.size() == 0) {
             std::cerr << "[logger] no output folder\n";
             assert (false && "log folder can't be empty");
@@ -292,58 +658,305 @@ private:
         return true;
     }
     //--------------------------------------------------------------------------
+    static bool valid_thread_cfg (const thread_cfg& t)
+    {
+        switch (t.policy) {
+        case sched_policy::inherit:
+            return true;
+        case sched_policy::other:
+            return t.priority >= -20 && t.priority <= 19;
+        case sched_policy::fifo:
+            return t.priority >= 1 && t.priority <= 99;
+        default:
+            return false;
+        }
+    }
+    //--------------------------------------------------------------------------
     void thread()
     {
         while (m_status.load (mo_acquire) != initialized) {                     // I guess that all Kernels do this for me when launching a thread, just being on the safe side in case is not true
             th::this_thread::yield();
         }
-        idle_rotate_if();
-        m_status.store (running, mo_relaxed);
-        uword alloc_fault = m_alloc_fault.load (mo_relaxed);
-        u64 next_flush = get_ns_timestamp() + (1 * 1000 * 1000 * 1000);
-        u64 sev_check  = next_flush;
-        change_current_filename();
-        severity_check();
+        setup_this_thread (config.consumer_thread);
+        consumer_start();
 
         while (true) {
-            auto res = m_fifo.sc_pop_prepare();
-            if (res.get_mem()) {
-                if (file_error_avoidance()) { /*will print errors on stdout-stderr*/
-                    non_idle_slice_and_rotate_if();
-                }
+            if (consumer_step()) {
                 m_wait.reset();
-                m_writer.decode_and_write (m_out, res.get_mem());
-                m_fifo.pop_commit (res);
             }
             else {
                 if (m_status.load (mo_relaxed) != running) {
                     break;
                 }
+                bool idle_work = false;
                 if (m_wait.next_wait_is_long_sleep()) {
-                    idle_rotate_if();
-                    auto now = get_ns_timestamp();
-                    if (timestamp_is_expired (now, next_flush)) {
-                        next_flush = now + (1 * 1000 * 1000 * 1000);
-                        m_out.flush();
-                    }
-                    if (timestamp_is_expired (now, sev_check)) {
-                        sev_check = now + (1 * 1000 * 1000 * 1000);
-                        severity_check();
+                    if (!m_io.active()) {
+                        idle_work = io_idle_tasks();
                     }
+                    severity_check_if (get_ns_timestamp());
+                }
+                if (!idle_work) {
+                    m_wait.wait();
                 }
-                m_wait.wait();
-            }
-            uword allocf_now = m_alloc_fault.load (mo_relaxed);
-            if (alloc_fault != allocf_now) {
-                write_alloc_fault (allocf_now - alloc_fault);
-                alloc_fault = allocf_now;
             }
         }
+        consumer_stop();
+    }
+    //--------------------------------------------------------------------------
+    void consumer_start()                                                       //on the consumer thread or on "init" when pumped
+    {
+        m_status.store (running, mo_relaxed);
+        m_alloc_fault_seen = m_alloc_fault.load (mo_relaxed);
+        m_next_sev_check   = get_ns_timestamp() + (1 * 1000 * 1000 * 1000);
+        severity_check();
+    }
+    //--------------------------------------------------------------------------
+    bool consumer_step()                                                        //returns if there was work
+    {
+        bool busy = m_pool.active() ? pipelined_step() : step();
+        uword allocf_now = m_alloc_fault.load (mo_relaxed);
+        if (m_alloc_fault_seen != allocf_now) {
+            write_alloc_fault (allocf_now - m_alloc_fault_seen);
+            m_alloc_fault_seen = allocf_now;
+        }
+        return busy;
+    }
+    //--------------------------------------------------------------------------
+    void severity_check_if (u64 now)
+    {
+        if (timestamp_is_expired (now, m_next_sev_check)) {
+            m_next_sev_check = now + (1 * 1000 * 1000 * 1000);
+            severity_check();
+        }
+    }
+    //--------------------------------------------------------------------------
+    void consumer_stop()
+    {
+        m_pool.stop();
+        m_io.stop();
+        m_out.close_sinks();
+        m_compressor.cancel();
         idle_rotate_if();
         m_out.file_close();
+        stop_preopener();
+        save_rotation_state();
         m_status.store (thread_stopped, mo_relaxed);
     }
     //--------------------------------------------------------------------------
+    bool step()
+    {
+        auto res = m_fifo.sc_pop_prepare();
+        if (!res.get_mem()) {
+            deliver (m_render);
+            return false;
+        }
+        m_writer.decode_and_write (m_render, res.get_mem());
+        m_fifo.pop_commit (res);
+        ++m_consumed;
+        if (m_render.bytes() >= config.io.buffer_bytes) {
+            deliver (m_render);
+        }
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    bool pipelined_step()
+    {
+        bool busy = false;
+        formatting_pool::batch* b;
+        while ((b = m_pool.next_rendered (false))) {
+            deliver (b->rendered);
+            m_pool.release();
+            busy = true;
+        }
+        b = m_pool.next_free();
+        if (b) {
+            while (b->entries.size() < m_pool.batch_entries()) {
+                auto res = m_fifo.sc_pop_prepare();
+                if (!res.get_mem()) {
+                    break;
+                }
+                b->entries.push_back (res);
+            }
+            if (b->entries.size()) {
+                m_consumed += b->entries.size();
+                m_pool.dispatch();
+                return true;
+            }
+        }
+        if (!m_pool.idle()) {
+            /* all batches in flight or nothing more to dispatch: wait for the
+               oldest one, it's the next one to be written anyways. */
+            b = m_pool.next_rendered (true);
+            deliver (b->rendered);
+            m_pool.release();
+            return true;
+        }
+        return busy;
+    }
+    //--------------------------------------------------------------------------
+    void deliver (render_buffer& b)                                             //"b" is returned empty
+    {
+        if (m_io.active()) {
+            m_io.submit (b);
+        }
+        else {
+            write_rendered (b);
+            b.clear();
+        }
+    }
+    //--------------------------------------------------------------------------
+    bool io_idle_tasks()                                                        //runs on the thread doing the I/O. returns if there is work left
+    {
+        idle_rotate_if();
+        auto now = get_ns_timestamp();
+        if (timestamp_is_expired (now, m_next_flush)) {
+            m_next_flush = now + (1 * 1000 * 1000 * 1000);
+            m_out.flush();
+        }
+        if (m_unsynced && timestamp_is_expired (now, m_next_sync)) {
+            file_sync (now);
+        }
+        if (!m_compressor.enabled()) {
+            return false;
+        }
+        return m_compressor.run (m_files_register, 2 * 1000 * 1000);            //small time slices, to keep reacting to new entries
+    }
+    //--------------------------------------------------------------------------
+    void write_rendered (const render_buffer& b)
+    {
+        if (b.empty()) {
+            return;
+        }
+        uword first = 0;
+        while (first < b.entry_count()) {
+            /* the slicing check is done before each entry that could make the
+               file reach its size, not once per batch. */
+            if (file_error_avoidance()) { /*will print errors on stdout-stderr*/
+                non_idle_slice_and_rotate_if();
+            }
+            write_clock_anchor_if();
+            uword last = slices_files() ?
+                m_out.file_chunk_end (b, first, config.file.aprox_size) :
+                b.entry_count();
+            m_out.write_entries (b, first, last);
+            preopen_next_slice_if();
+            first = last;
+        }
+        auto now = get_ns_timestamp();
+        if (m_tsc.enabled() && timestamp_is_expired (now, m_next_calib)) {
+            m_next_calib = now + (1 * 1000 * 1000 * 1000);
+            m_tsc.calibrate();
+        }
+        if (config.file.durability >= file_durability::fdatasync) {
+            m_unsynced = true;
+            if (timestamp_is_expired (now, m_next_sync) ||
+                (config.file.durability == file_durability::sync_acks &&
+                    needs_sync_ack (b))
+                ) {
+                /* group commit: every waiter on this batch shares one
+                   fdatasync. Waiters arriving meanwhile share the next one */
+                file_sync (now);
+            }
+        }
+        for (uword i = 0; i < b.entry_count(); ++i) {
+            if (b[i].sync) {
+                m_sync->notify (*b[i].sync);
+            }
+        }
+    }
+    //--------------------------------------------------------------------------
+    void init_clock (u64 steady_base)
+    {
+        auto clock = config.misc.clock;
+        bool tsc   = clock == clock_source::tsc ||
+            (clock == clock_source::steady &&
+                config.misc.producer_timestamp &&
+                config.display.show_timestamp);
+        if (tsc && m_tsc.init (steady_base)) {
+            clock = clock_source::tsc;                                          //converted to "steady" nanoseconds
+        }
+        else if (clock == clock_source::tsc) {
+            clock = clock_source::steady;
+        }
+        m_timestamps.clock               = clock;
+        m_timestamps.producer_timestamps = config.misc.producer_timestamp;
+        switch (clock) {
+        case clock_source::tsc:
+            m_timestamps.base = m_tsc.tick_base();
+            break;
+        case clock_source::coarse:
+            m_timestamps.base = get_coarse_ns_timestamp();
+            break;
+        case clock_source::realtime:
+            m_timestamps.base = 0;
+            break;
+        default:
+            m_timestamps.base = steady_base;
+            break;
+        }
+        m_writer.set_clock(
+            m_timestamps, clock == clock_source::tsc ? &m_tsc : nullptr
+            );
+    }
+    //--------------------------------------------------------------------------
+    void write_clock_anchor_if()                                                //on the thread doing the I/O
+    {
+        if (!config.misc.clock_anchor_period_s ||
+            config.misc.clock == clock_source::realtime ||
+            !m_out.file_is_open()
+            ) {
+            return;
+        }
+        u64 now = get_ns_timestamp();
+        if (m_out.file_bytes_written() != 0 &&
+            !timestamp_is_expired (now, m_next_anchor)
+            ) {
+            return;
+        }
+        m_next_anchor = now +
+            (u64) config.misc.clock_anchor_period_s * 1000 * 1000 * 1000;
+        const u64 ns_sec = 1000 * 1000 * 1000;
+        u64 t    = m_writer.now();
+        u64 real = get_realtime_ns_timestamp();
+        char str[96];
+        int len = mem_printf(
+            str,
+            sizeof str,
+            "%011llu.%09llu [clock_anchor] realtime=%llu.%09llu\n",
+            (unsigned long long) (t / ns_sec),
+            (unsigned long long) (t % ns_sec),
+            (unsigned long long) (real / ns_sec),
+            (unsigned long long) (real % ns_sec)
+            );
+        if (len > 0) {
+            m_out.file_raw_write (str, (uword) len);
+        }
+    }
+    //--------------------------------------------------------------------------
+    static bool needs_sync_ack (const render_buffer& b)
+    {
+        for (uword i = 0; i < b.entry_count(); ++i) {
+            if (b[i].sync || b[i].flush) {
+                return true;
+            }
+        }
+        return false;
+    }
+    //--------------------------------------------------------------------------
+    u64 sync_period_ns() const
+    {
+        return (u64) config.file.sync_period_ms * 1000 * 1000;
+    }
+    //--------------------------------------------------------------------------
+    void file_sync (u64 now)
+    {
+        if (m_out.file_is_open() && !m_out.file_sync()) {
+            std::cerr << "[logger] fdatasync failed\n";
+        }
+        m_unsynced  = false;
+        m_next_sync = now + sync_period_ns();
+    }
+    //--------------------------------------------------------------------------
     const char* change_current_filename()
     {
         using namespace ch;
@@ -354,17 +967,30 @@ private:
         return m_files_register.change_current_filename (cpu, calendar_us);
     }
     //--------------------------------------------------------------------------
+    const char* change_next_filename()
+    {
+        using namespace ch;
+        u64 cpu         = get_ns_timestamp();
+        u64 calendar_us = duration_cast<microseconds>(
+                        system_clock::now().time_since_epoch()
+                        ).count();
+        return m_files_register.change_next_filename (cpu, calendar_us);
+    }
+    //--------------------------------------------------------------------------
     void write_alloc_fault (uword count)
     {
         char str[96];
-        mem_printf(
+        int len = mem_printf(
                 str,
                 sizeof str,
                 "[%020llu] [logger_err] %u alloc faults detected",
                 get_ns_timestamp(),
                 count
                 );
-        m_out.raw_write (sev::error, str);
+        m_render.entry_begin (sev::error);
+        m_render.write (str, (len > 0) ? (uword) len : 0);
+        m_render.entry_end();
+        deliver (m_render);
     }
     //--------------------------------------------------------------------------
     bool slices_files() const
@@ -383,6 +1009,11 @@ private:
         return (slices_files() && m_files_register.rotates());
     }
     //--------------------------------------------------------------------------
+    bool recycles() const
+    {
+        return config.file.rotation.recycle_files && config.file.aprox_size;
+    }
+    //--------------------------------------------------------------------------
     bool reopen_file()
     {
         m_out.file_close();
@@ -452,8 +1083,23 @@ private:
     {
         bool success = true;
         if (force || has_to_slice_now()) {
-            m_out.file_close();
-            success = m_out.file_open (change_current_filename());
+            if (m_compressor.enabled() && m_out.file_is_open()) {
+                m_compressor.push (m_files_register.current_filename());
+            }
+            if (force || !switch_to_preopened_slice()) {
+                m_preopen.cancel();
+                m_out.file_close();
+                const char* old = nullptr;
+                if (!force && recycles()) {
+                    old = m_files_register.rotation_list_recycle_oldest(
+                        config.file.rotation.file_count +
+                        config.file.rotation.delayed_file_count - 1
+                        );
+                }
+                success = old ?
+                    m_out.file_recycle (old, change_current_filename()) :
+                    m_out.file_open (change_current_filename());
+            }
             if (success && rotates()) {
                 m_files_register.rotation_list_keep_newer(
                     config.file.rotation.file_count +
@@ -465,6 +1111,63 @@ private:
         return success;
     }
     //--------------------------------------------------------------------------
+    void preopen_next_slice_if()
+    {
+        if (m_preopen.active() &&
+            !m_preopen.requested() &&
+            m_out.file_bytes_written() >= m_preopen_bytes
+            ) {
+            m_preopen.request (change_next_filename());
+        }
+    }
+    //--------------------------------------------------------------------------
+    bool switch_to_preopened_slice()
+    {
+        file next;
+        if (!m_preopen.requested() ||
+            !m_out.file_is_open() ||
+            !m_preopen.take (next)
+            ) {
+            return false;
+        }
+        m_out.file_swap (next);
+        m_preopen.retire(
+            next, config.file.durability >= file_durability::fdatasync
+            );
+        m_files_register.next_filename_to_current();
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    void stop_preopener()
+    {
+        m_preopen.stop();
+        m_files_register.set_eraser (log_file_register::erase_fn());
+    }
+    //--------------------------------------------------------------------------
+    void save_rotation_state()
+    {
+        if (!rotates() || !config.file.rotation.discover_past_files) {
+            return;
+        }
+        past_executions_file_list files;
+        if (!m_files_register.rotation_list_get (files) ||
+            !past_files_scanner::save_state(
+                files,
+                with_separator (config.file.out_folder),
+                config.file.name_prefix
+                )) {
+            std::cerr << "[logger] unable to save the rotation state\n";
+        }
+    }
+    //--------------------------------------------------------------------------
+    static std::string with_separator (const std::string& folder)
+    {
+        if (folder.size() && folder[folder.size() - 1] != fs_separator) {
+            return folder + fs_separator;
+        }
+        return folder;
+    }
+    //--------------------------------------------------------------------------
     void idle_rotate_if()
     {
         if (rotates()) {
@@ -535,6 +1238,23 @@ private:
     //--------------------------------------------------------------------------
     output              m_out;
     log_writer          m_writer;
+    render_buffer       m_render;
+    formatting_pool     m_pool;
+    async_to_sync*      m_sync;
+    io_stage            m_io;
+    slice_compressor    m_compressor;
+    slice_preopener     m_preopen;
+    u64                 m_preopen_bytes;
+#if defined (MAL_UNIX_LIKE)
+    tcp_sink            m_tcp;
+#endif
+    u64                 m_next_flush;
+    u64                 m_next_sync;
+    u64                 m_next_calib;
+    u64                 m_next_anchor;
+    tsc_clock           m_tsc;
+    timestamp_data      m_timestamps;
+    bool                m_unsynced;
     sev_update_evt      m_sev_evt;
     log_file_register   m_files_register;
     th::thread          m_log_thread;
@@ -543,6 +1263,12 @@ private:
     sleep_queue_backoff m_wait;
     atomic_uword        m_alloc_fault;
     bool                m_on_error_avoidance;
+    uword               m_alloc_fault_seen;
+    u64                 m_consumed;
+    u64                 m_next_sev_check;
+    bool                m_manual_pump;
+    atomic_bool         m_pump_armed;
+    pump_notifier       m_notifier;
  };
 //------------------------------------------------------------------------------
 } //namespaces
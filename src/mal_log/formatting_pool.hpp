@@ -0,0 +1,258 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_FORMATTING_POOL_HPP_
+#define MAL_LOG_FORMATTING_POOL_HPP_
+
+#include <cassert>
+#include <vector>
+
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/thread.hpp>
+#include <mal_log/util/thread_setup.hpp>
+#include <mal_log/queue.hpp>
+#include <mal_log/log_writer.hpp>
+#include <mal_log/render_buffer.hpp>
+
+namespace mal {
+
+// Formatting threads for the pipelined backend mode.
+//
+// The consumer thread dequeues entries into batches and dispatches them in
+// order. Each worker has its own "log_writer" and renders whole batches into
+// the batch's "render_buffer", releasing the queue entries as soon as they are
+// rendered. The consumer retrieves the rendered batches in dispatch order, so
+// the output order is the same as the queue order regardless of which worker
+// finished first.
+//
+// There are twice as many batches as workers, so the consumer can keep filling
+// batches while the workers are busy and the workers can keep rendering while
+// the consumer is writing.
+//
+// All the public functions are to be called from the consumer thread only.
+//------------------------------------------------------------------------------
+class formatting_pool
+{
+public:
+    //--------------------------------------------------------------------------
+    struct batch {
+        std::vector<queue_prepared> entries;
+        render_buffer               rendered;
+        uword                       state;
+    };
+    //--------------------------------------------------------------------------
+    formatting_pool()
+    {
+        m_fifo          = nullptr;
+        m_batch_entries = 0;
+        m_dispatched    = 0;
+        m_written       = 0;
+        m_rendering     = 0;
+        m_stop          = false;
+        thread_cfg_set_defaults (m_thread_cfg);
+    }
+    //--------------------------------------------------------------------------
+    ~formatting_pool()
+    {
+        stop();
+    }
+    //--------------------------------------------------------------------------
+    void set_thread_cfg (const thread_cfg& c)                                   //to be called before "init"
+    {
+        m_thread_cfg = c;
+    }
+    //--------------------------------------------------------------------------
+    bool init(
+        uword workers, uword batch_entries, queue& fifo, const log_writer& w
+        )
+    {
+        assert (workers && batch_entries);
+        assert (!active());
+        m_fifo          = &fifo;
+        m_batch_entries = batch_entries;
+        m_dispatched    = m_written = m_rendering = 0;
+        m_stop          = false;
+        try {
+            m_batches.resize (workers * 2);
+            for (uword i = 0; i < m_batches.size(); ++i) {
+                m_batches[i].entries.reserve (batch_entries);
+                m_batches[i].state = empty;
+            }
+            for (uword i = 0; i < workers; ++i) {
+                m_workers.push_back (th::thread ([this, w]() { worker (w); }));
+            }
+        }
+        catch (...) {
+            stop();
+            return false;
+        }
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    void stop()
+    {
+        if (!active()) {
+            return;
+        }
+        assert (idle());
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            m_stop = true;
+        }
+        m_work_available.notify_all();
+        for (uword i = 0; i < m_workers.size(); ++i) {
+            m_workers[i].join();
+        }
+        m_workers.clear();
+        m_batches.clear();
+    }
+    //--------------------------------------------------------------------------
+    bool active() const
+    {
+        return m_batches.size() != 0;
+    }
+    //--------------------------------------------------------------------------
+    bool idle() const
+    {
+        return m_written == m_dispatched;
+    }
+    //--------------------------------------------------------------------------
+    uword batch_entries() const
+    {
+        return m_batch_entries;
+    }
+    //--------------------------------------------------------------------------
+    batch* next_free()
+    {
+        if ((m_dispatched - m_written) == m_batches.size()) {
+            return nullptr;
+        }
+        batch& b = get (m_dispatched);
+        assert (b.state == empty);
+        return &b;
+    }
+    //--------------------------------------------------------------------------
+    void dispatch()                                                             //dispatches the batch returned by "next_free"
+    {
+        assert (get (m_dispatched).entries.size());
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            get (m_dispatched).state = pending;
+            ++m_dispatched;
+        }
+        m_work_available.notify_one();
+    }
+    //--------------------------------------------------------------------------
+    batch* next_rendered (bool block)                                          //oldest dispatched batch, if it is already rendered
+    {
+        if (idle()) {
+            return nullptr;
+        }
+        batch& b = get (m_written);
+        th::unique_lock<th::mutex> lock (m_lock);
+        if (block) {
+            m_batch_rendered.wait (lock, [&]() { return b.state == rendered; });
+        }
+        return (b.state == rendered) ? &b : nullptr;
+    }
+    //--------------------------------------------------------------------------
+    void release()                                                              //releases the batch returned by "next_rendered"
+    {
+        batch& b = get (m_written);
+        assert (b.state == rendered);
+        b.entries.clear();
+        b.rendered.clear();
+        b.state = empty;
+        ++m_written;
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    enum batch_state {
+        empty,
+        pending,
+        rendering,
+        rendered,
+    };
+    //--------------------------------------------------------------------------
+    batch& get (uword seq)
+    {
+        return m_batches[seq % m_batches.size()];
+    }
+    //--------------------------------------------------------------------------
+    void worker (log_writer w)
+    {
+        setup_this_thread (m_thread_cfg);
+        th::unique_lock<th::mutex> lock (m_lock);
+        while (true) {
+            m_work_available.wait (lock, [this]() {
+                return m_stop || (m_rendering != m_dispatched);
+            });
+            if (m_rendering == m_dispatched) {
+                return;
+            }
+            batch& b = get (m_rendering);
+            ++m_rendering;
+            b.state = rendering;
+            lock.unlock();
+
+            for (uword i = 0; i < b.entries.size(); ++i) {
+                w.decode_and_write (b.rendered, b.entries[i].get_mem());
+                m_fifo->pop_commit (b.entries[i]);
+            }
+            lock.lock();
+            b.state = rendered;
+            m_batch_rendered.notify_one();
+        }
+    }
+    //--------------------------------------------------------------------------
+    std::vector<batch>          m_batches;
+    std::vector<th::thread>     m_workers;
+    thread_cfg                  m_thread_cfg;
+    th::mutex                   m_lock;
+    th::condition_variable      m_work_available;
+    th::condition_variable      m_batch_rendered;
+    queue*                      m_fifo;
+    uword                       m_batch_entries;
+    uword                       m_dispatched; /*written by the consumer only*/
+    uword                       m_written;    /*consumer thread only*/
+    uword                       m_rendering;  /*workers only*/
+    bool                        m_stop;
+};
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_FORMATTING_POOL_HPP_ */
@@ -56,13 +56,15 @@ class frontend::frontend_impl
 {
 public:
     //--------------------------------------------------------------------------
-    frontend_impl()
+    frontend_impl (severity_filter& filter) : m_filter (filter)
     {
         m_state               = no_init;
-        m_min_severity        = sev::notice;
         m_prints_timestamp    = true;
         m_producer_timestamp  = true;
         m_timestamp_base      = 0;
+        m_timestamps.base     = 0;
+        m_timestamps.producer_timestamps = false;
+        m_timestamps.clock    = clock_source::steady;
         srand ((unsigned int) get_ns_timestamp() >> 2);
     }
     //--------------------------------------------------------------------------
@@ -149,7 +151,10 @@ public:
             {
                 m_prints_timestamp   = c.display.show_timestamp;
                 m_producer_timestamp = c.misc.producer_timestamp;
+                m_timestamps         = m_back.timestamps();
+                m_filter.set_min_severity (m_back.min_severity());
                 m_state.store (init, mo_release);
+                m_filter.set_initialized();
                 return frontend::init_ok;
             }
             else {
@@ -182,15 +187,36 @@ public:
         return m_timestamp_base;
     }
     //--------------------------------------------------------------------------
+    timestamp_data timestamps() const
+    {
+        timestamp_data d      = m_timestamps;
+        d.producer_timestamps = producer_timestamp();
+        return d;
+    }
+    //--------------------------------------------------------------------------
     void on_termination()
     {
         uword actual = init;
         if (m_state.compare_exchange_strong (actual, terminated, mo_relaxed)) {
+            m_filter.set_terminated();
             m_sync.cancel_all();
             m_back.on_termination();
         }
     }
     //--------------------------------------------------------------------------
+    uword pump (uword max_entries, u64 max_ns)
+    {
+        if (m_state.load (mo_relaxed) != init) {
+            return 0;
+        }
+        return m_back.pump (max_entries, max_ns);
+    }
+    //--------------------------------------------------------------------------
+    int pump_fd() const
+    {
+        return m_back.pump_fd();
+    }
+    //--------------------------------------------------------------------------
     bool set_console_severity (sev::severity std_err, sev::severity std_out)
     {
         if ((std_out >= sev::invalid || std_err >= sev::invalid)) {
@@ -202,7 +228,7 @@ public:
             return false;
         }
         m_back.set_console_severity (std_err, std_out);
-        m_min_severity = m_back.min_severity();
+        m_filter.set_min_severity (m_back.min_severity());
         return true;
     }
     //--------------------------------------------------------------------------
@@ -210,22 +236,19 @@ public:
     {
         assert (s < sev::invalid);
         m_back.set_file_severity (s);
-        m_min_severity = m_back.min_severity();
+        m_filter.set_min_severity (m_back.min_severity());
     }
     //--------------------------------------------------------------------------
-    bool initialized() const
+    void set_sink_severity (sink& s, sev::severity sev)
     {
-        return (m_state == init);
+        assert (sev < sev::invalid);
+        s.set_severity (sev);
+        m_filter.set_min_severity (m_back.min_severity());
     }
     //--------------------------------------------------------------------------
     sev::severity min_severity() const
     {
-        return (sev::severity) m_min_severity.val();
-    }
-    //--------------------------------------------------------------------------
-    bool can_log (sev::severity s) const
-    {
-        return initialized() && (s >= min_severity());
+        return m_filter.min_severity();
     }
     //--------------------------------------------------------------------------
     bool producer_timestamp() const
@@ -237,7 +260,7 @@ private:
     //--------------------------------------------------------------------------
     void severity_updated_event()
     {
-        m_min_severity = m_back.min_severity();
+        m_filter.set_min_severity (m_back.min_severity());
     }
     //--------------------------------------------------------------------------
     enum state
@@ -249,7 +272,8 @@ private:
     };
     //--------------------------------------------------------------------------
     u64                      m_timestamp_base;
-    mo_relaxed_atomic<uword> m_min_severity;
+    timestamp_data           m_timestamps;
+    severity_filter&         m_filter;
     mo_relaxed_atomic<uword> m_state;
     backend_impl             m_back;
     async_to_sync            m_sync;
@@ -260,7 +284,7 @@ private:
 MAL_LIB_EXPORTED_CLASS frontend::frontend()
 {
     m = nullptr;
-    m = new frontend::frontend_impl();
+    m = new frontend::frontend_impl (m_filter);
 }
 //------------------------------------------------------------------------------
 MAL_LIB_EXPORTED_CLASS frontend::~frontend()
@@ -318,12 +342,6 @@ sev::severity MAL_LIB_EXPORTED_CLASS frontend::min_severity() const
     assert (is_constructed());
     return m->min_severity();
 }
-//--------------------------------------------------------------------------
-bool MAL_LIB_EXPORTED_CLASS frontend::can_log (sev::severity s) const
-{
-    assert (is_constructed());
-    return m->can_log (s);
-}
 //------------------------------------------------------------------------------
 void MAL_LIB_EXPORTED_CLASS frontend::set_file_severity (sev::severity s)
 {
@@ -338,13 +356,18 @@ bool MAL_LIB_EXPORTED_CLASS frontend::set_console_severity(
     assert (is_constructed());
     return m->set_console_severity (std_err, std_out);
 }
+//------------------------------------------------------------------------------
+void MAL_LIB_EXPORTED_CLASS frontend::set_sink_severity(
+           sink& s, sev::severity sev
+           )
+{
+    assert (is_constructed());
+    return m->set_sink_severity (s, sev);
+}
 //--------------------------------------------------------------------------
 timestamp_data MAL_LIB_EXPORTED_CLASS frontend::get_timestamp_data() const
 {
-    timestamp_data d;
-    d.producer_timestamps = m->producer_timestamp();
-    d.base                = m->timestamp_base();
-    return d;
+    return m->timestamps();
 }
 //------------------------------------------------------------------------------
 void MAL_LIB_EXPORTED_CLASS frontend::on_termination()
@@ -353,6 +376,18 @@ void MAL_LIB_EXPORTED_CLASS frontend::on_termination()
     return m->on_termination();
 }
 //------------------------------------------------------------------------------
+uword MAL_LIB_EXPORTED_CLASS frontend::pump (uword max_entries, u64 max_ns)
+{
+    assert (is_constructed());
+    return m->pump (max_entries, max_ns);
+}
+//------------------------------------------------------------------------------
+int MAL_LIB_EXPORTED_CLASS frontend::pump_fd() const
+{
+    assert (is_constructed());
+    return m->pump_fd();
+}
+//------------------------------------------------------------------------------
 } //namespace
 
 #endif /* MAL_LOG_LOG_FRONTEND_CPP_ */
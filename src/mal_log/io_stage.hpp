@@ -0,0 +1,206 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_IO_STAGE_HPP_
+#define MAL_LOG_IO_STAGE_HPP_
+
+#include <cassert>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/thread.hpp>
+#include <mal_log/util/thread_setup.hpp>
+#include <mal_log/util/chrono.hpp>
+#include <mal_log/render_buffer.hpp>
+
+namespace mal {
+
+// Dedicated I/O thread for the backend.
+//
+// The formatting side renders into a "render_buffer" and submits it. The
+// submitted buffer is swapped (no copy) with an empty one from a bounded pool,
+// so the formatting side can continue rendering while the I/O thread writes.
+// When all the buffers are in flight "submit" blocks: a slow disk consumes the
+// buffer slack first and only back-pressures the producers after it.
+//
+// The "idle" callback is run on the I/O thread at most once each
+// "idle_period_ms", only when there are no submitted buffers pending. It's
+// meant for flushing and file maintenance. If it reports more pending work it
+// is run again as soon as there are no submitted buffers.
+//------------------------------------------------------------------------------
+class io_stage
+{
+public:
+    //--------------------------------------------------------------------------
+    typedef std::function<void (render_buffer&)> write_fn;
+    typedef std::function<bool()>                 idle_fn;                      //returns if it has more work to do
+    //--------------------------------------------------------------------------
+    static const uword idle_period_ms = 100;
+    //--------------------------------------------------------------------------
+    io_stage()
+    {
+        m_stop   = false;
+        m_active = false;
+        thread_cfg_set_defaults (m_thread_cfg);
+    }
+    //--------------------------------------------------------------------------
+    ~io_stage()
+    {
+        stop();
+    }
+    //--------------------------------------------------------------------------
+    void set_thread_cfg (const thread_cfg& c)                                   //to be called before "init"
+    {
+        m_thread_cfg = c;
+    }
+    //--------------------------------------------------------------------------
+    bool init (uword buffer_count, const write_fn& write, const idle_fn& idle)
+    {
+        assert (buffer_count && write && idle);
+        assert (!m_active);
+        m_write = write;
+        m_idle  = idle;
+        m_stop  = false;
+        try {
+            m_buffers.resize (buffer_count);
+            for (uword i = 0; i < m_buffers.size(); ++i) {
+                m_free.push_back (&m_buffers[i]);
+            }
+            m_thread = th::thread ([this]() { this->thread(); });
+        }
+        catch (...) {
+            m_free.clear();
+            m_buffers.clear();
+            return false;
+        }
+        m_active = true;
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    void stop()                                                                 //writes all the submitted buffers before returning
+    {
+        if (!m_active) {
+            return;
+        }
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            m_stop = true;
+        }
+        m_submitted_cond.notify_one();
+        m_thread.join();
+        m_free.clear();
+        m_submitted.clear();
+        m_buffers.clear();
+        m_active = false;
+    }
+    //--------------------------------------------------------------------------
+    bool active() const
+    {
+        return m_active;
+    }
+    //--------------------------------------------------------------------------
+    void submit (render_buffer& b)                                              //"b" is returned empty
+    {
+        assert (m_active);
+        if (b.empty()) {
+            return;
+        }
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            m_free_cond.wait (lock, [this]() { return !m_free.empty(); });
+            render_buffer* dst = m_free.back();
+            m_free.pop_back();
+            dst->swap (b);
+            m_submitted.push_back (dst);
+        }
+        m_submitted_cond.notify_one();
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    void thread()
+    {
+        setup_this_thread (m_thread_cfg);
+        auto period    = ch::milliseconds (idle_period_ms);
+        auto next_idle = ch::steady_clock::now() + period;
+        th::unique_lock<th::mutex> lock (m_lock);
+        while (true) {
+            m_submitted_cond.wait_until (lock, next_idle, [this]() {
+                return m_stop || !m_submitted.empty();
+            });
+            if (!m_submitted.empty()) {
+                render_buffer* b = m_submitted.front();
+                m_submitted.pop_front();
+                lock.unlock();
+                m_write (*b);
+                b->clear();
+                lock.lock();
+                m_free.push_back (b);
+                m_free_cond.notify_one();
+                continue;
+            }
+            if (m_stop) {
+                return;
+            }
+            auto now = ch::steady_clock::now();
+            if (now >= next_idle) {
+                lock.unlock();
+                bool more = m_idle();
+                lock.lock();
+                next_idle = more ? now : now + period;
+            }
+        }
+    }
+    //--------------------------------------------------------------------------
+    std::vector<render_buffer>  m_buffers;
+    std::vector<render_buffer*> m_free;
+    std::deque<render_buffer*>  m_submitted;
+    write_fn                    m_write;
+    idle_fn                     m_idle;
+    th::mutex                   m_lock;
+    th::condition_variable      m_free_cond;
+    th::condition_variable      m_submitted_cond;
+    th::thread                  m_thread;
+    thread_cfg                  m_thread_cfg;
+    bool                        m_stop;
+    bool                        m_active;
+};
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_IO_STAGE_HPP_ */
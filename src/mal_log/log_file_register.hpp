@@ -42,9 +42,10 @@ either expressed or implied, of Rafael Gago Castano.
 #include <cstdio>
 #include <string>
 #include <deque>
-#include <ostream>
+#include <iostream>
 #include <fstream>
 #include <vector>
+#include <functional>
 
 #include <mal_log/util/system.hpp>
 #include <mal_log/util/side_effect_assert.hpp>
@@ -61,13 +62,16 @@ namespace mal {
 class log_file_register
 {
 public:
+    //--------------------------------------------------------------------------
+    typedef std::function<void (const char*)> erase_fn;
     //--------------------------------------------------------------------------
     bool init(
         uword                          file_count,
         std::string                    folder,
         const std::string&             prefix,
         const std::string&             suffix,
-        const std::deque<std::string>& previous
+        const std::deque<std::string>& previous,
+        uword                          extra_name_chars = 0                    //room for renaming rotation list entries
         )
     {
         assert (file_count == 0 || file_count > 1);
@@ -76,7 +80,8 @@ public:
             uword max_name = folder.size() +
                              prefix.size() +
                              fixed_chars_in_name +
-                             suffix.size();
+                             suffix.size() +
+                             extra_name_chars;
             for (uword i = 0; i < previous.size(); ++i) {
                 max_name = (previous[i].size() > max_name) ?
                                 previous[i].size() : max_name;
@@ -85,6 +90,8 @@ public:
             std::deque<std::string> prev;
 
             m_current_fname.resize (max_name, 0);
+            m_next_fname.resize (m_current_fname.size(), 0);
+            m_recycled_fname.resize (m_current_fname.size(), 0);
 
             prev = previous;
             while (file_count && ((prev.size() > file_count))) {
@@ -102,7 +109,9 @@ public:
                 }
                 for (auto it = prev.begin(); it != prev.end(); ++it) {
                     m_rotation_list.push_tail();
-                    std::memcpy (m_rotation_list.tail(), &(*it)[0], it->size());
+                    std::memcpy(
+                        m_rotation_list.tail(), it->c_str(), it->size() + 1
+                        );
                 }
             }
             return true;
@@ -127,7 +136,9 @@ public:
             }
             for (uword i = 0; ; ++i) {
                 std::string empty;
-                new_file_name_c_str_in_buffer (folder, empty, empty, i ,i + 1);
+                new_file_name_c_str_in_buffer(
+                    m_current_fname, folder, empty, empty, i ,i + 1
+                    );
                 const char* fn = current_filename();
                 std::ofstream file (fn);
                 file.write ((const char*) &fn, m_current_fname.size());
@@ -161,11 +172,25 @@ public:
     const char* change_current_filename (u64 cpu, u64 calendar_us)
     {
         new_file_name_c_str_in_buffer(
-                m_folder, m_prefix, m_suffix, cpu, calendar_us
+                m_current_fname, m_folder, m_prefix, m_suffix, cpu, calendar_us
                 );
         return current_filename();
     }
     //--------------------------------------------------------------------------
+    const char* change_next_filename (u64 cpu, u64 calendar_us)                 //name for a file to be opened ahead of time
+    {
+        new_file_name_c_str_in_buffer(
+                m_next_fname, m_folder, m_prefix, m_suffix, cpu, calendar_us
+                );
+        return &m_next_fname[0];
+    }
+    //--------------------------------------------------------------------------
+    const char* next_filename_to_current()
+    {
+        m_current_fname.swap (m_next_fname);
+        return current_filename();
+    }
+    //--------------------------------------------------------------------------
     const char* current_filename()
     {
         return &m_current_fname[0];
@@ -186,16 +211,74 @@ public:
     {
         assert (rotates());
         while (m_rotation_list.size() > keep_count) {
-            erase_file ((const char*) m_rotation_list.head());
+            if (m_eraser) {
+                m_eraser ((const char*) m_rotation_list.head());
+            }
+            else {
+                erase_file ((const char*) m_rotation_list.head());
+            }
             m_rotation_list.pop_head();
         }
     }
     //--------------------------------------------------------------------------
+    const char* rotation_list_recycle_oldest (uword keep_count)                 //the newest expired file is returned instead of erased. nullptr if none
+    {
+        assert (rotates());
+        if (m_rotation_list.size() <= keep_count) {
+            return nullptr;
+        }
+        rotation_list_keep_newer (keep_count + 1);
+        std::memcpy(
+            &m_recycled_fname[0],
+            m_rotation_list.head(),
+            m_rotation_list.entry_byte_size()
+            );
+        m_rotation_list.pop_head();
+        return &m_recycled_fname[0];
+    }
+    //--------------------------------------------------------------------------
+    bool rotation_list_get (std::deque<std::string>& dst)                       //oldest at front
+    {
+        assert (rotates());
+        try {
+            dst.clear();
+            for (uword i = 0; i < m_rotation_list.size(); ++i) {
+                dst.push_back ((const char*) m_rotation_list.at (i));
+            }
+        }
+        catch (...) {
+            return false;
+        }
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    bool rotation_list_rename (const char* from, const char* to)
+    {
+        assert (rotates());
+        uword sz = std::strlen (to) + 1;
+        if (sz > m_rotation_list.entry_byte_size()) {
+            return false;
+        }
+        for (uword i = 0; i < m_rotation_list.size(); ++i) {
+            char* entry = (char*) m_rotation_list.at (i);
+            if (std::strcmp (entry, from) == 0) {
+                std::memcpy (entry, to, sz);
+                return true;
+            }
+        }
+        return false;
+    }
+    //--------------------------------------------------------------------------
     void set_timestamp_base (u64 v)
     {
         m_cpu_time_base = v;
     }
     //--------------------------------------------------------------------------
+    void set_eraser (const erase_fn& e)                                         //to delete rotated files out of the calling thread. Can be empty
+    {
+        m_eraser = e;
+    }
+    //--------------------------------------------------------------------------
 private:
     //--------------------------------------------------------------------------
     void append_separator_if (std::string& folder)
@@ -211,6 +294,7 @@ private:
     }
     //--------------------------------------------------------------------------
     void new_file_name_c_str_in_buffer(
+            std::vector<char>& dst,
             const std::string& folder,
             const std::string& prefix,
             const std::string& suffix,
@@ -218,7 +302,7 @@ private:
             u64                calendar_us
             )
     {
-        assert (m_current_fname.size() >=
+        assert (dst.size() >=
                 (folder.size() +
                  prefix.size() +
                  suffix.size() +
@@ -226,7 +310,7 @@ private:
                  1
                  )
                 );
-        char* str = &m_current_fname[0];
+        char* str = &dst[0];
         auto sz   = folder.size();
         std::memcpy (str, &folder[0], sz);
         str += sz;
@@ -269,6 +353,9 @@ private:
     //--------------------------------------------------------------------------
     std::string         m_folder, m_prefix, m_suffix;
     std::vector<char>   m_current_fname;
+    std::vector<char>   m_next_fname;
+    std::vector<char>   m_recycled_fname;
+    erase_fn            m_eraser;
     raw_circular_buffer m_rotation_list;
     u64                 m_cpu_time_base;
     //--------------------------------------------------------------------------
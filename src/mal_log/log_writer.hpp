@@ -43,9 +43,10 @@ either expressed or implied, of Rafael Gago Castano.
 #include <mal_log/serialization/importer.hpp>
 #include <mal_log/mal_private.hpp>
 #include <mal_log/timestamp.hpp>
-#include <mal_log/output.hpp>
+#include <mal_log/frontend.hpp>
+#include <mal_log/tsc_clock.hpp>
+#include <mal_log/render_buffer.hpp>
 #include <mal_log/format_tokens.hpp>
-#include <mal_log/async_to_sync.hpp>
 
 namespace mal {
 
@@ -56,24 +57,28 @@ public:
     //--------------------------------------------------------------------------
     log_writer()
     {
-        m_timestamp_base = 0;
-        m_fmt            = nullptr;
-        m_fmt_modif      = 0;
-        prints_severity  = prints_timestamp = true;
-        m_sync           = nullptr;
+        m_clock.base                = 0;
+        m_clock.clock               = clock_source::steady;
+        m_clock.producer_timestamps = false;
+        m_tsc                       = nullptr;
+        m_fmt                       = nullptr;
+        m_fmt_modif                 = 0;
+        prints_severity             = prints_timestamp = true;
     }
     //--------------------------------------------------------------------------
-    void set_synchronizer (async_to_sync& sync)
+    void set_clock (const timestamp_data& td, const tsc_clock* tsc)             //"tsc" only for the "tsc" clock
     {
-        m_sync = &sync;
+        assert ((td.clock == clock_source::tsc) == (tsc != nullptr));
+        m_clock = td;
+        m_tsc   = tsc;
     }
     //--------------------------------------------------------------------------
-    void set_timestamp_base (u64 base)
+    u64 now() const                                                             //as printed, thread safe
     {
-        m_timestamp_base = base;
+        return to_ns (get_entry_timestamp (m_clock));
     }
     //--------------------------------------------------------------------------
-    bool decode_and_write (output& o, const u8* msg)
+    bool decode_and_write (render_buffer& o, const u8* msg)
     {
         assert (msg);
 
@@ -82,16 +87,13 @@ public:
         ser::header_data h;
         do_import (h);
 
-        if (h.sync != nullptr) { m_sync->notify (*h.sync); }
-
         set_next_msg_fmt_string (h.fmt);
-        o.entry_begin (h.severity);
+        o.entry_begin (h.severity, h.sync);
 
         if (prints_timestamp) {
             write_timestamp(
                 o,
-                h.has_tstamp ?
-                    h.tstamp : (get_ns_timestamp() - m_timestamp_base)
+                to_ns (h.has_tstamp ? h.tstamp : get_entry_timestamp (m_clock))
                 );
         }
         if (prints_severity) { write_severity (o, h.severity); }
@@ -149,7 +151,7 @@ public:
     //--------------------------------------------------------------------------
 private:
     //--------------------------------------------------------------------------
-    void consume_next (output& o, bool has_placeholder)
+    void consume_next (render_buffer& o, bool has_placeholder)
     {
         using namespace ser;
         ser::decoding_field d;
@@ -170,7 +172,7 @@ private:
     }
     //--------------------------------------------------------------------------
     void output_integral(
-            output& o, ser::integral_field f, bool has_placeholder
+            render_buffer& o, ser::integral_field f, bool has_placeholder
             )
     {
         using namespace ser;
@@ -191,7 +193,7 @@ private:
     }
     //--------------------------------------------------------------------------
     void output_non_integral(
-            output& o, ser::non_integral_field f, bool has_placeholder
+            render_buffer& o, ser::non_integral_field f, bool has_placeholder
             )
     {
         using namespace ser;
@@ -220,7 +222,7 @@ private:
     }
     //--------------------------------------------------------------------------
     void output_non_numeric(
-            output& o, ser::non_numeric_field f, bool has_placeholder
+            render_buffer& o, ser::non_numeric_field f, bool has_placeholder
             )
     {
         using namespace ser;
@@ -263,10 +265,23 @@ private:
         case mal_deep_copied_mem : {
             deep_copy_bytes bytes;
             do_import (bytes, f);
-            if (has_placeholder) {
-                byte_stream_convert::execute(
+            if (!has_placeholder) {
+                break;
+            }
+            switch (m_fmt_modif) {
+            case 0:
+            case fmt::hex:
+                byte_stream_convert::hex (o, (const u8*) bytes.mem, bytes.size);
+                break;
+            case fmt::base64:
+                byte_stream_convert::base64(
                         o, (const u8*) bytes.mem, bytes.size
                         );
+                break;
+            default:
+                write_invalid_modifier (o);
+                byte_stream_convert::hex (o, (const u8*) bytes.mem, bytes.size);
+                break;
             }
             break;
         }
@@ -278,7 +293,7 @@ private:
     //--------------------------------------------------------------------------
     template <class fmt_struct>
     void output_char(
-            output& o, ser::integral_field f, bool has_placeholder
+            render_buffer& o, ser::integral_field f, bool has_placeholder
             )
     {
         using namespace ser;
@@ -312,7 +327,7 @@ private:
     //--------------------------------------------------------------------------
     template <class T, class fmt_struct>
     void output_int_type(
-            output& o, ser::integral_field f, bool has_placeholder
+            render_buffer& o, ser::integral_field f, bool has_placeholder
             )
     {
         T v;
@@ -342,7 +357,7 @@ private:
     //--------------------------------------------------------------------------
     template <class T, class H, class fmt_struct>
     void output_floating_type(
-            output& o, ser::non_integral_field f, bool has_placeholder)
+            render_buffer& o, ser::non_integral_field f, bool has_placeholder)
     {
         union hex_hack {
             T floating;
@@ -383,20 +398,21 @@ private:
         m_fmt = fmt;
     }
     //--------------------------------------------------------------------------
-    bool find_param_in_fmt_str (output& o, bool remaining_parameters = true)
+    bool find_param_in_fmt_str (render_buffer& o, bool remaining_parameters = true)
     {
         assert (m_fmt);
         static const char param_error[] = "{a parameter was expected here}";
 
         auto fmt_prev = m_fmt;
         while (m_fmt != nullptr) {
-            auto found = std::strchr (m_fmt, fmt::placeholder_open);
-            if (found && found[1] != 0) {
+            auto found = find_chr_or_nul (m_fmt, fmt::placeholder_open);
+            if (*found != 0 && found[1] != 0) {
                 m_fmt       = found + 1;
                 m_fmt_modif = *m_fmt;
             }
             else {
-                o.write (fmt_prev);
+                found += (*found != 0) ? 1 : 0; //trailing '{'
+                o.write (fmt_prev, found - fmt_prev);
                 m_fmt_modif = 0;
                 return false;
             }
@@ -421,7 +437,7 @@ private:
     }
     //--------------------------------------------------------------------------
     template <class T>
-    static bool output_num (output& o, T val, const char* fmt)
+    static bool output_num (render_buffer& o, T val, const char* fmt)
     {
         char buff[64];                                                          //just to skip thinking, never is going to be that big.
         uword adv = mem_printf (buff, sizeof buff, fmt, val);
@@ -433,7 +449,7 @@ private:
         return false;
     }
     //--------------------------------------------------------------------------
-    static void write_severity (output& o, sev::severity s)
+    static void write_severity (render_buffer& o, sev::severity s)
     {
         switch (s) {
         case sev::debug: {
@@ -471,7 +487,7 @@ private:
         }
     }
     //--------------------------------------------------------------------------
-    static void write_invalid_modifier (output& o)
+    static void write_invalid_modifier (render_buffer& o)
     {
         static const char invalid_modif_str[] =
                 "([logger err]->invalid modifier for next parameter, ignored) ";
@@ -479,7 +495,7 @@ private:
         assert (false && "invalid modifier");
     }
     //--------------------------------------------------------------------------
-    static void write_timestamp (output& o, u64 t)
+    static void write_timestamp (render_buffer& o, u64 t)
     {
         const u64 ns_sec = 1000000000;
         u64 s = t / ns_sec;
@@ -488,10 +504,15 @@ private:
         output_num (o, t, "%09llu ");
     }
     //--------------------------------------------------------------------------
-    u64            m_timestamp_base;
-    const char*    m_fmt;
-    async_to_sync* m_sync;
-    char           m_fmt_modif;
+    u64 to_ns (u64 t) const
+    {
+        return m_tsc ? m_tsc->to_ns (t) : t;
+    }
+    //--------------------------------------------------------------------------
+    timestamp_data   m_clock;
+    const tsc_clock* m_tsc;
+    const char*      m_fmt;
+    char             m_fmt_modif;
 };
 //------------------------------------------------------------------------------
 } //namespaces
@@ -37,13 +37,20 @@ either expressed or implied, of Rafael Gago Castano.
 #ifndef MAL_LOG_LOG_OUTPUT_HPP_
 #define MAL_LOG_LOG_OUTPUT_HPP_
 
-#include <cstdio>
 #include <cassert>
-#include <fstream>
-#include <iostream>
+#include <memory>
+#include <vector>
 #include <mal_log/util/integer.hpp>
 #include <mal_log/util/atomic.hpp>
+#include <mal_log/util/file.hpp>
+#include <mal_log/util/lz4_frame.hpp>
+#include <mal_log/util/string_scan.hpp>
 #include <mal_log/frontend_types.hpp>
+#include <mal_log/cfg.hpp>
+#include <mal_log/sink.hpp>
+#include <mal_log/async_sink.hpp>
+#include <mal_log/render_buffer.hpp>
+#include <mal_log/console_sink.hpp>
 
 namespace mal {
 //------------------------------------------------------------------------------
@@ -51,18 +58,159 @@ class output
 {
 public:
     //--------------------------------------------------------------------------
-    output()
+    output() : m_stderr_console (stderr), m_stdout_console (stdout)
     {
-        m_sev_current = sev::off;
-        m_stderr_sev  = sev::off;
-        m_stdout_sev  = sev::off;
+        m_stderr      = &m_stderr_console;
+        m_stdout      = &m_stdout_console;
         m_file_sev    = sev::warning;
+        m_file_bytes  = 0;
+        m_compress    = false;
+        m_durability  = file_durability::flush;
+        m_prealloc    = 0;
+    }
+    //--------------------------------------------------------------------------
+    void set_sinks (const sink_list& l)                                         //to be called before any write. "l" has to outlive this object
+    {
+        m_sinks.clear();
+        for (auto it = l.begin(); it != l.end(); ++it) {
+            m_sinks.push_back (it->get());
+        }
+    }
+    //--------------------------------------------------------------------------
+    void add_sink (sink& s)                                                     //internal sinks, after "set_sinks"
+    {
+        m_sinks.push_back (&s);
+    }
+    //--------------------------------------------------------------------------
+    void remove_sink (sink& s)                                                  //to be called before any write
+    {
+        for (uword i = 0; i < m_sinks.size(); ++i) {
+            if (m_sinks[i] == &s) {
+                m_sinks.erase (m_sinks.begin() + i);
+                return;
+            }
+        }
+    }
+    //--------------------------------------------------------------------------
+    bool set_console_queue(
+        const sink_queue_cfg& c, const thread_cfg& t                            //to be called before any write
+        )
+    {
+        if (!c.buffer_count) {
+            return true;
+        }
+        auto no_delete = [](sink*) {};                                          //members
+        try {
+            m_stderr_queue.reset (new async_sink(
+                std::shared_ptr<sink> (&m_stderr_console, no_delete)
+                ));
+            m_stdout_queue.reset (new async_sink(
+                std::shared_ptr<sink> (&m_stdout_console, no_delete)
+                ));
+        }
+        catch (...) {
+            m_stderr_queue.reset();
+            m_stdout_queue.reset();
+            return false;
+        }
+        sink_queue_cfg err = c;
+        sink_queue_cfg out = c;
+        const thread_cfg& base =
+            thread_cfg_is_default (c.thread) ? t : c.thread;
+        err.thread = thread_cfg_with_role (base, "stderr");
+        out.thread = thread_cfg_with_role (base, "stdout");
+        if (!m_stderr_queue->init (err) || !m_stdout_queue->init (out)) {
+            m_stderr_queue.reset();
+            m_stdout_queue.reset();
+            return false;
+        }
+        m_stderr_queue->set_severity (m_stderr->severity());
+        m_stdout_queue->set_severity (m_stdout->severity());
+        m_stderr = m_stderr_queue.get();
+        m_stdout = m_stdout_queue.get();
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    void reset_console_queue()                                                  //undoes "set_console_queue", stops its threads
+    {
+        if (!m_stderr_queue) {
+            return;
+        }
+        m_stderr_console.set_severity (m_stderr->severity());
+        m_stdout_console.set_severity (m_stdout->severity());
+        m_stderr = &m_stderr_console;
+        m_stdout = &m_stdout_console;
+        m_stderr_queue.reset();
+        m_stdout_queue.reset();
+    }
+    //--------------------------------------------------------------------------
+    void close_sinks()                                                          //no writes allowed after this call
+    {
+        m_stderr->close();
+        m_stdout->close();
+        for (uword i = 0; i < m_sinks.size(); ++i) {
+            m_sinks[i]->close();
+        }
+    }
+    //--------------------------------------------------------------------------
+    void set_durability (file_durability::level d)
+    {
+        m_durability = d;
+    }
+    //--------------------------------------------------------------------------
+    void set_file_preallocation (u64 bytes)                                     //0 = disabled. Truncates the files on close
+    {
+        m_prealloc = bytes;
+    }
+    //--------------------------------------------------------------------------
+    bool set_file_compression (file_compression::type c)                        //to be called with the file closed
+    {
+        assert (!file_is_open());
+        m_compress = (c == file_compression::lz4);
+        if (!m_compress) {
+            m_lz4.free();
+            return true;
+        }
+        return m_lz4.init();
     }
     //--------------------------------------------------------------------------
     bool file_open (const char* file)
     {
-        m_file.open (file);
-        return file_no_error();
+        m_file_bytes = 0;
+        m_file.open (file, m_compress);
+        return file_opened();
+    }
+    //--------------------------------------------------------------------------
+    bool file_recycle (const char* old_file, const char* file)                  //renames and overwrites "old_file". falls back to "file_open"
+    {
+        m_file_bytes = 0;
+        if (std::rename (old_file, file) != 0) {
+            std::remove (old_file);
+            return file_open (file);
+        }
+        if (!m_file.open_existing (file, m_compress)) {
+            std::remove (file);
+            return file_open (file);
+        }
+        return file_opened();
+    }
+    //--------------------------------------------------------------------------
+    void file_swap (file& f)                                                    //switches to an already opened file, "f" returns the previous one (flushed)
+    {
+        if (file_is_open()) {
+            if (m_compress) {
+                m_lz4.end (m_file);
+            }
+            m_file.flush();
+            if (m_prealloc) {
+                m_file.truncate_here();
+            }
+        }
+        m_file.swap (f);
+        m_file_bytes = 0;
+        if (m_compress && file_no_error()) {
+            m_lz4.begin (m_file);
+        }
     }
     //--------------------------------------------------------------------------
     bool file_is_open ()
@@ -73,6 +221,15 @@ public:
     void file_close()
     {
         if (file_is_open()) {
+            if (m_compress) {
+                m_lz4.end (m_file);
+            }
+            if (m_prealloc) {
+                m_file.truncate_here();
+            }
+            if (m_durability >= file_durability::fdatasync) {
+                m_file.sync();
+            }
             m_file.close();
         }
     }
@@ -84,12 +241,34 @@ public:
     //--------------------------------------------------------------------------
     void flush()
     {
-        m_file.flush();
+        if (m_durability >= file_durability::flush) {
+            file_flush();
+        }
+        m_stderr->flush();
+        m_stdout->flush();
+        for (uword i = 0; i < m_sinks.size(); ++i) {
+            m_sinks[i]->flush();
+        }
+    }
+    //--------------------------------------------------------------------------
+    void file_raw_write (const char* d, uword sz)                               //bypasses the severity
+    {
+        if (file_is_open()) {
+            file_write (d, sz);
+        }
     }
     //--------------------------------------------------------------------------
-    uword file_bytes_written()
+    bool file_sync()                                                            //fdatasync
     {
-        return (uword) m_file.tellp();
+        if (m_compress) {
+            m_lz4.flush (m_file);
+        }
+        return m_file.sync();
+    }
+    //--------------------------------------------------------------------------
+    uword file_bytes_written()                                                  //uncompressed
+    {
+        return m_file_bytes;
     }
     //--------------------------------------------------------------------------
     void set_console_severity(
@@ -100,8 +279,8 @@ public:
         assert (stderr_sev < sev::invalid);
         assert (stdout_sev < sev::invalid);
         assert ((stdout_sev < stderr_sev) || stdout_sev == sev::off);
-        m_stderr_sev = stderr_sev;
-        m_stdout_sev = stdout_sev;
+        m_stderr->set_severity (stderr_sev);
+        m_stdout->set_severity (stdout_sev);
     }
     //--------------------------------------------------------------------------
     void set_file_severity (sev::severity sev)
@@ -112,12 +291,12 @@ public:
     //--------------------------------------------------------------------------
     sev::severity stderr_sev() const
     {
-        return (sev::severity) m_stderr_sev;
+        return m_stderr->severity();
     }
     //--------------------------------------------------------------------------
     sev::severity stdout_sev() const
     {
-        return (sev::severity) m_stdout_sev;
+        return m_stdout->severity();
     }
     //--------------------------------------------------------------------------
     sev::severity file_sev() const
@@ -134,79 +313,213 @@ public:
 
         auto min = (err <= out)  ? err : out;
         min      = (min <= file) ? min : file;
+        for (uword i = 0; i < m_sinks.size(); ++i) {
+            sev::severity s = m_sinks[i]->severity();
+            min             = (min <= s) ? min : s;
+        }
         return min;
     }
     //--------------------------------------------------------------------------
-    void entry_begin (sev::severity s)
+    // One past the entry on ["first", entry_count) that makes the file reach
+    // "file_bytes" bytes, "entry_count" if none does. The entries going to the
+    // file have to be split there to keep the slices close to their size.
+    uword file_chunk_end (const render_buffer& b, uword first, u64 file_bytes)
     {
-        assert (s < sev::invalid);
-        m_sev_current = s;
+        u64           bytes = m_file_bytes;
+        sev::severity min   = file_sev();
+        for (uword i = first; i < b.entry_count(); ++i) {
+            if (b[i].severity >= min) {
+                bytes += b[i].size;
+                if (bytes >= file_bytes) {
+                    return i + 1;
+                }
+            }
+        }
+        return b.entry_count();
     }
     //--------------------------------------------------------------------------
-    void entry_end()
+    void write_entries (const render_buffer& b, uword first, uword last)        //one write call per sink
     {
-        char newline = '\n';
-        write (&newline, sizeof newline);
+        assert (first <= last && last <= b.entry_count());
+        sev::severity err_min = stderr_sev();
+        sev::severity out_min = stdout_sev();
+
+        make_spans (b, first, last, file_sev(), sev::invalid);
+        for (uword i = 0; i < m_spans.size(); ++i) {
+            file_write (m_spans[i].data, m_spans[i].size);
+            if (m_spans[i].flush && m_durability >= file_durability::flush) {
+                file_flush();
+            }
+        }
+        make_spans (b, first, last, err_min, sev::invalid);
+        to_sink (*m_stderr);
+        make_spans (b, first, last, out_min, err_min);
+        to_sink (*m_stdout);
+        for (uword i = 0; i < m_sinks.size(); ++i) {
+            make_spans(
+                b,
+                first,
+                last,
+                m_sinks[i]->severity(),
+                sev::invalid,
+                m_sinks[i]->split_by_severity()
+                );
+            to_sink (*m_sinks[i]);
+        }
     }
     //--------------------------------------------------------------------------
-    void write (const void* d, uword sz)
+    void raw_write (sev::severity s, const char* str)
     {
-        write_impl (m_sev_current, d, sz);
+        static const uword max_str = 2048;
+
+        if (str == nullptr || str[0] == 0) { return; }
+
+        uword len = find_nul (str, max_str + 1);
+        if (len <= max_str) {
+            write_impl (s, str, len);
+            return;
+        }
+        static const char too_long[] = " [logger err]->string too long";
+        write_impl (s, str, max_str);
+        write_impl (s, too_long, sizeof too_long - 1);
     }
     //--------------------------------------------------------------------------
-    void write (const char* str)
+private:
+    //--------------------------------------------------------------------------
+    void make_spans(
+        const render_buffer& b,
+        uword                first,
+        uword                last,
+        sev::severity        min,
+        sev::severity        max_excl,
+        bool                 split_by_severity = false
+        )
     {
-        raw_write (m_sev_current, str);
+        m_spans.clear();
+        sink_span* span = nullptr;                                              //open span, contiguous entries are merged
+        for (uword i = first; i < last; ++i) {
+            const render_buffer::entry& e = b[i];
+            if (e.severity < min || e.severity >= max_excl) {
+                span = nullptr;
+                continue;
+            }
+            if (span && split_by_severity && span->min_sev != e.severity) {
+                span = nullptr;
+            }
+            if (!span) {
+                sink_span s;
+                s.data    = b.data() + e.offset;
+                s.size    = 0;
+                s.entries = 0;
+                s.min_sev = e.severity;
+                s.max_sev = e.severity;
+                s.flush   = false;
+                m_spans.push_back (s);
+                span = &m_spans.back();
+            }
+            assert (span->data + span->size == b.data() + e.offset);
+            span->size += e.size;
+            ++span->entries;
+            span->min_sev = (span->min_sev <= e.severity) ?
+                span->min_sev : e.severity;
+            span->max_sev = (span->max_sev >= e.severity) ?
+                span->max_sev : e.severity;
+            if (e.flush) {
+                span->flush = true;
+                span        = nullptr;
+            }
+        }
     }
     //--------------------------------------------------------------------------
-    void raw_write (sev::severity s, const char* str)
+    void to_sink (sink& s)
     {
-        static const uword max_str    = 2048;
-        static const uword block_max  = 64;
-        static const uword block_mask = block_max - 1;
-
-        if (str == nullptr || str[0] == 0) { return; }
-
-        uword i = 1;
-        for (; i <= max_str; ++i) {
-            if ((i & block_mask) == 0) {
-                uword last_block_first = ((i - 1) & ~block_mask);
-                write_impl (s, str + last_block_first, block_max);
-            }
-            if (str[i] == 0) {
-                uword this_block_offset = i & block_mask;
-                write_impl (s, str + i - this_block_offset, this_block_offset); //if /0 is the first character of the block I perform a 0 length write.
+        if (m_spans.empty()) {
+            return;
+        }
+        s.write (&m_spans[0], m_spans.size());
+        for (uword i = 0; i < m_spans.size(); ++i) {
+            if (m_spans[i].flush) {
+                s.flush();
                 return;
             }
         }
-        if (i == max_str + 1) {
-            static const char too_long[] = " [logger err]->string too long";
-            write_impl (s, too_long, sizeof too_long - 1);
+    }
+    //--------------------------------------------------------------------------
+    void file_write (const void* d, uword sz)
+    {
+        if (!m_compress) {
+            m_file.write (d, sz);
+        }
+        else {
+            m_lz4.write (m_file, d, sz);
         }
+        m_file_bytes += sz;
     }
     //--------------------------------------------------------------------------
-private:
+    void file_flush()
+    {
+        if (m_compress) {
+            m_lz4.flush (m_file);
+        }
+        m_file.flush();
+    }
     //--------------------------------------------------------------------------
-    void write_impl (sev::severity s, const void* d, uword sz)
+    bool file_opened()
     {
-        if (sz && d) {
-            if (s >= m_file_sev) {
-                m_file.write ((const char*) d, sz);
+        if (file_no_error()) {
+            if (m_prealloc) {
+                m_file.preallocate (m_prealloc);
             }
-            if (s >= m_stderr_sev) {
-                std::cerr.write ((const char*) d, sz);
+            if (m_compress) {
+                m_lz4.begin (m_file);
             }
-            else if (s >= m_stdout_sev) {
-                std::cout.write ((const char*) d, sz);
+        }
+        return file_no_error();
+    }
+    //--------------------------------------------------------------------------
+    void write_impl (sev::severity s, const char* d, uword sz)
+    {
+        if (!sz || !d) {
+            return;
+        }
+        if (s >= m_file_sev) {
+            file_write (d, sz);
+        }
+        sink_span span;
+        span.data    = d;
+        span.size    = sz;
+        span.entries = 1;
+        span.min_sev = s;
+        span.max_sev = s;
+        span.flush   = false;
+        if (s >= stderr_sev()) {
+            m_stderr->write (&span, 1);
+        }
+        else if (s >= stdout_sev()) {
+            m_stdout->write (&span, 1);
+        }
+        for (uword i = 0; i < m_sinks.size(); ++i) {
+            if (s >= m_sinks[i]->severity()) {
+                m_sinks[i]->write (&span, 1);
             }
         }
     }
     //--------------------------------------------------------------------------
-    sev::severity                    m_sev_current;
-    mo_relaxed_atomic<sev::severity> m_stderr_sev;
-    mo_relaxed_atomic<sev::severity> m_stdout_sev;
     mo_relaxed_atomic<sev::severity> m_file_sev;
-    std::ofstream                    m_file;
+    console_sink                     m_stderr_console;
+    console_sink                     m_stdout_console;
+    std::unique_ptr<async_sink>      m_stderr_queue;
+    std::unique_ptr<async_sink>      m_stdout_queue;
+    sink*                            m_stderr;
+    sink*                            m_stdout;
+    std::vector<sink*>               m_sinks;
+    std::vector<sink_span>           m_spans;
+    file                             m_file;
+    lz4_frame_writer                 m_lz4;
+    uword                            m_file_bytes;
+    u64                              m_prealloc;
+    file_durability::level           m_durability;
+    bool                             m_compress;
 };
 //------------------------------------------------------------------------------
 }
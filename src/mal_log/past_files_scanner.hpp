@@ -0,0 +1,326 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_PAST_FILES_SCANNER_HPP_
+#define MAL_LOG_PAST_FILES_SCANNER_HPP_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mal_log/util/system.hpp>
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/calendar_str.hpp>
+#include <mal_log/util/mem_printf.hpp>
+#include <mal_log/cfg.hpp>
+
+#if defined (MAL_UNIX_LIKE)
+    #include <dirent.h>
+    #include <sys/stat.h>
+#endif
+
+namespace mal {
+
+// Finds the files left by previous runs on the log folder (POSIX only).
+//
+// A file matches when its name is "prefix", the "[cpu][base][calendar]" part
+// written by "log_file_register", "suffix" and optionally "extra_suffix" (the
+// closed slice compression extension). The list is sorted by the calendar time
+// and then by the cpu time, oldest first.
+//
+// A state file with the rotation list can be written on exit. It's only used
+// if the folder modification time is still the one recorded on it, so any
+// file added, deleted or renamed on the folder afterwards invalidates it. It
+// has to be loaded before creating or deleting anything on the folder.
+//------------------------------------------------------------------------------
+class past_files_scanner
+{
+public:
+    //--------------------------------------------------------------------------
+    static bool scan(
+            past_executions_file_list& out,
+            const std::string&         folder,                                  //ended in separator
+            const std::string&         prefix,
+            const std::string&         suffix,
+            const std::string&         extra_suffix
+            )
+    {
+        out.clear();
+#if defined (MAL_UNIX_LIKE)
+        DIR* dir = ::opendir (folder.c_str());
+        if (!dir) {
+            return false;
+        }
+        typedef std::pair<std::string, std::string> key_name;
+        std::vector<key_name> found;
+        try {
+            while (dirent* e = ::readdir (dir)) {
+                uword len = std::strlen (e->d_name);
+                if (!matches(
+                        e->d_name, len, prefix, suffix, extra_suffix
+                        )) {
+                    continue;
+                }
+                const char* stamps = e->d_name + prefix.size();
+                found.push_back (key_name());
+                /* calendar time first, then cpu time */
+                found.back().first.assign(
+                    stamps + cpu_chars, calendar_str::str_size
+                    );
+                found.back().first.append (stamps + 1, hex_chars);
+                found.back().second = folder + e->d_name;
+            }
+            ::closedir (dir);
+            std::sort (found.begin(), found.end());
+            for (auto it = found.begin(); it != found.end(); ++it) {
+                out.push_back (std::string());
+                out.back().swap (it->second);
+            }
+        }
+        catch (...) {
+            ::closedir (dir);
+            out.clear();
+            return false;
+        }
+        return true;
+#else
+        (void) folder; (void) prefix; (void) suffix; (void) extra_suffix;
+        return false;
+#endif
+    }
+    //--------------------------------------------------------------------------
+    static bool save_state(
+            const past_executions_file_list& files,
+            const std::string&               folder,
+            const std::string&               prefix
+            )
+    {
+#if defined (MAL_UNIX_LIKE)
+        std::string name = state_filename (folder, prefix);
+        std::string tmp  = name + ".tmp";
+        std::FILE*  f    = std::fopen (tmp.c_str(), "w");
+        if (!f) {
+            return false;
+        }
+        bool ok = write_header (f, 0, 0);
+        for (auto it = files.begin(); ok && it != files.end(); ++it) {
+            ok = std::fprintf (f, "%s\n", it->c_str()) > 0;
+        }
+        ok &= (std::fclose (f) == 0);
+        if (!ok || std::rename (tmp.c_str(), name.c_str()) != 0) {
+            std::remove (tmp.c_str());
+            return false;
+        }
+        /* the folder modification time is final now. Overwriting the file
+           contents doesn't change it */
+        u64 sec, nsec;
+        f = folder_mtime (folder, sec, nsec) ?
+            std::fopen (name.c_str(), "r+") : nullptr;
+        if (!f) {
+            std::remove (name.c_str());
+            return false;
+        }
+        ok  = write_header (f, sec, nsec);
+        ok &= (std::fclose (f) == 0);
+        if (!ok) {
+            std::remove (name.c_str());
+        }
+        return ok;
+#else
+        (void) files; (void) folder; (void) prefix;
+        return false;
+#endif
+    }
+    //--------------------------------------------------------------------------
+    static bool load_state(
+            past_executions_file_list& out,
+            const std::string&         folder,
+            const std::string&         prefix
+            )
+    {
+        out.clear();
+#if defined (MAL_UNIX_LIKE)
+        u64 sec, nsec;
+        if (!folder_mtime (folder, sec, nsec)) {
+            return false;
+        }
+        std::string name = state_filename (folder, prefix);
+        std::FILE*  f    = std::fopen (name.c_str(), "r");
+        if (!f) {
+            return false;
+        }
+        char line[4096];
+        bool ok = std::fgets (line, sizeof line, f) != nullptr;
+        if (ok) {
+            char expected[header_chars + 1];
+            format_header (expected, sec, nsec);
+            ok = std::strcmp (line, expected) == 0;
+        }
+        try {
+            while (ok && std::fgets (line, sizeof line, f)) {
+                uword len = std::strlen (line);
+                ok = (len > 1) && (line[len - 1] == '\n');
+                out.push_back (std::string (line, len - 1));
+            }
+        }
+        catch (...) {
+            ok = false;
+        }
+        std::fclose (f);
+        if (!ok) {
+            out.clear();
+        }
+        return ok;
+#else
+        (void) folder; (void) prefix;
+        return false;
+#endif
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    static const uword hex_chars = 16;
+    static const uword cpu_chars = 1 + hex_chars + 2 + hex_chars + 2;           //"[cpu][base]["
+    //--------------------------------------------------------------------------
+    static bool matches(
+            const char*        name,
+            uword              len,
+            const std::string& prefix,
+            const std::string& suffix,
+            const std::string& extra_suffix
+            )
+    {
+        uword stamp_len = cpu_chars + calendar_str::str_size + 1;
+        uword fixed_len = prefix.size() + stamp_len + suffix.size();
+        if (len == fixed_len + extra_suffix.size() && extra_suffix.size()) {
+            if (std::memcmp(
+                    name + fixed_len, extra_suffix.c_str(), extra_suffix.size()
+                    ) != 0) {
+                return false;
+            }
+        }
+        else if (len != fixed_len) {
+            return false;
+        }
+        if (std::memcmp (name, prefix.c_str(), prefix.size()) != 0 ||
+            std::memcmp(
+                name + prefix.size() + stamp_len, suffix.c_str(), suffix.size()
+                ) != 0
+            ) {
+            return false;
+        }
+        /* "[%016x][%016x][YYYY-MM-DD_hh-mm-ss.uuuuuu]" */
+        static const char pattern[] =
+            "[xxxxxxxxxxxxxxxx][xxxxxxxxxxxxxxxx][dddd-dd-dd_dd-dd-dd.dddddd]";
+        static_assert(
+            sizeof pattern - 1 == cpu_chars + calendar_str::str_size + 1,
+            "fix the pattern"
+            );
+        const char* s = name + prefix.size();
+        for (uword i = 0; i < sizeof pattern - 1; ++i) {
+            char c = s[i];
+            switch (pattern[i]) {
+            case 'x':
+                if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+                    return false;
+                }
+                break;
+            case 'd':
+                if (c < '0' || c > '9') {
+                    return false;
+                }
+                break;
+            default:
+                if (c != pattern[i]) {
+                    return false;
+                }
+                break;
+            }
+        }
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    static std::string state_filename(
+            const std::string& folder, const std::string& prefix
+            )
+    {
+        return folder + "." + prefix + "rotation_state";
+    }
+    //--------------------------------------------------------------------------
+#if defined (MAL_UNIX_LIKE)
+    static bool folder_mtime (const std::string& folder, u64& sec, u64& nsec)
+    {
+        struct stat st;
+        if (::stat (folder.c_str(), &st) != 0) {
+            return false;
+        }
+        sec  = (u64) st.st_mtime;
+    #if defined (__APPLE__)
+        nsec = (u64) st.st_mtimespec.tv_nsec;
+    #else
+        nsec = (u64) st.st_mtim.tv_nsec;
+    #endif
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    static void format_header (char* dst, u64 sec, u64 nsec)                   //fixed size, so it can be overwritten
+    {
+        mem_printf(
+            dst,
+            header_chars + 1,
+            "mal_rotation_v1 %020llu %09llu\n",
+            (unsigned long long) sec,
+            (unsigned long long) nsec
+            );
+    }
+    //--------------------------------------------------------------------------
+    static bool write_header (std::FILE* f, u64 sec, u64 nsec)
+    {
+        char h[header_chars + 1];
+        format_header (h, sec, nsec);
+        return std::fputs (h, f) >= 0;
+    }
+#endif
+    //--------------------------------------------------------------------------
+    static const uword header_chars = 15 + 1 + 20 + 1 + 9 + 1;
+};
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_PAST_FILES_SCANNER_HPP_ */
@@ -0,0 +1,162 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_RENDER_BUFFER_HPP_
+#define MAL_LOG_RENDER_BUFFER_HPP_
+
+#include <cassert>
+#include <vector>
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/string_scan.hpp>
+#include <mal_log/frontend_types.hpp>
+#include <mal_log/sync_point.hpp>
+
+namespace mal {
+
+// Formatted log entries waiting to be written. The "log_writer" renders into
+// this buffer instead of writing directly to the sinks, so formatting can be
+// done on a thread different than the one doing the I/O. The per-entry data
+// is kept to be able to filter by severity on each sink, to flush after
+// critical entries and to wake up synchronous producers once the entry has
+// been written (not just decoded).
+//------------------------------------------------------------------------------
+class render_buffer
+{
+public:
+    //--------------------------------------------------------------------------
+    struct entry {
+        uword         offset;
+        uword         size;
+        sync_point*   sync;
+        sev::severity severity;
+        bool          flush;
+    };
+    //--------------------------------------------------------------------------
+    static const uword max_str = 2048;
+    //--------------------------------------------------------------------------
+    void clear()
+    {
+        m_bytes.clear();
+        m_entries.clear();
+    }
+    //--------------------------------------------------------------------------
+    void swap (render_buffer& other)
+    {
+        m_bytes.swap (other.m_bytes);
+        m_entries.swap (other.m_entries);
+    }
+    //--------------------------------------------------------------------------
+    void entry_begin (sev::severity s, sync_point* sync = nullptr)
+    {
+        assert (s < sev::invalid);
+        entry e;
+        e.offset   = m_bytes.size();
+        e.size     = 0;
+        e.sync     = sync;
+        e.severity = s;
+        e.flush    = false;
+        m_entries.push_back (e);
+    }
+    //--------------------------------------------------------------------------
+    void entry_end()
+    {
+        assert (m_entries.size());
+        m_bytes.push_back ('\n');
+        entry& e = m_entries.back();
+        e.size   = m_bytes.size() - e.offset;
+    }
+    //--------------------------------------------------------------------------
+    void flush()
+    {
+        assert (m_entries.size());
+        m_entries.back().flush = true;
+    }
+    //--------------------------------------------------------------------------
+    void write (const void* d, uword sz)
+    {
+        const char* c = (const char*) d;
+        if (sz && c) {
+            m_bytes.insert (m_bytes.end(), c, c + sz);
+        }
+    }
+    //--------------------------------------------------------------------------
+    void write (const char* str)
+    {
+        if (str == nullptr) { return; }
+        uword len = find_nul (str, max_str + 1);
+        if (len > max_str) {
+            static const char too_long[] = " [logger err]->string too long";
+            write (str, max_str);
+            write (too_long, sizeof too_long - 1);
+            return;
+        }
+        write (str, len);
+    }
+    //--------------------------------------------------------------------------
+    bool empty() const
+    {
+        return m_entries.empty();
+    }
+    //--------------------------------------------------------------------------
+    uword entry_count() const
+    {
+        return m_entries.size();
+    }
+    //--------------------------------------------------------------------------
+    const entry& operator[] (uword idx) const
+    {
+        assert (idx < m_entries.size());
+        return m_entries[idx];
+    }
+    //--------------------------------------------------------------------------
+    const char* data() const
+    {
+        return m_bytes.data();
+    }
+    //--------------------------------------------------------------------------
+    uword bytes() const
+    {
+        return m_bytes.size();
+    }
+    //--------------------------------------------------------------------------
+private:
+    std::vector<char>  m_bytes;
+    std::vector<entry> m_entries;
+};
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_RENDER_BUFFER_HPP_ */
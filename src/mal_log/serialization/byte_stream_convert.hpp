@@ -37,105 +37,163 @@ either expressed or implied, of Rafael Gago Castano.
 #ifndef MAL_LOG_LOG_BYTE_STREAM_CONVERT_HPP_
 #define MAL_LOG_LOG_BYTE_STREAM_CONVERT_HPP_
 
-#include <mal_log/output.hpp>
+#include <mal_log/render_buffer.hpp>
+#include <mal_log/util/cpu_features.hpp>
 
-// disclaimer: this is an overkill when dealing with files, it's a copy-paste
-//             of some code I had lying around. Then I felt bad, I simplified
-//             it but everything remains the same: it still is a miserable
-//             overkill.
+// Renders "deep_copy_bytes" payloads. The conversion is done in chunks on a
+// stack buffer, so the destination receives a few big writes instead of one
+// write per 16 input bytes. This matters when logging e.g. packet captures.
 
 namespace mal { namespace ser {
 //------------------------------------------------------------------------------
-
 namespace detail {
 
-#if 0
-static const char hex_lut[] = "000102030405060708090a0b0c0d0e0f"
-                              "101112131415161718191a1b1c1d1e1f"
-                              "202122232425262728292a2b2c2d2e2f"
-                              "303132333435363738393a3b3c3d3e3f"
-                              "404142434445464748494a4b4c4d4e4f"
-                              "505152535455565758595a5b5c5d5e5f"
-                              "606162636465666768696a6b6c6d6e6f"
-                              "707172737475767778797a7b7c7d7e7f"
-                              "808182838485868788898a8b8c8d8e8f"
-                              "909192939495969798999a9b9c9d9e9f"
-                              "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
-                              "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
-                              "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
-                              "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
-                              "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
-                              "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
-template<uword remaining>
-struct hex_unroll
+static const char hex_lut[]    = "0123456789abcdef";
+static const char base64_lut[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+//------------------------------------------------------------------------------
+inline void hex_scalar (char* dst, const u8* src, uword sz)
 {
-    inline static const u8* convert (char* dst, const u8* src)
-    {
-        *dst++ = hex_lut[((*src_buff) * 2)];
-        *dst++ = hex_lut[((*src_buff) * 2) + 1];
-        return hex_unroll<remaining - 1>::convert (dst, ++src);
+    for (uword i = 0; i < sz; ++i) {
+        *dst++ = hex_lut[src[i] >> 4];
+        *dst++ = hex_lut[src[i] & 15];
     }
-};
-
-template<>
-struct hex_unroll<0>
+}
+//------------------------------------------------------------------------------
+#if defined (MAL_HAS_SSE2)
+inline __m128i hex_nibbles_to_ascii_sse2 (__m128i n)
 {
-    inline static const u8* convert (char* dst, const u8* src)
-    {
-        return src;
+    // '0' + n, plus the distance between '9' + 1 and 'a' for n > 9
+    __m128i gt9 = _mm_cmpgt_epi8 (n, _mm_set1_epi8 (9));
+    __m128i v   = _mm_add_epi8 (n, _mm_set1_epi8 ('0'));
+    return _mm_add_epi8 (v, _mm_and_si128 (gt9, _mm_set1_epi8 ('a' - '9' - 1)));
+}
+//------------------------------------------------------------------------------
+inline uword hex_sse2 (char* dst, const u8* src, uword sz)                      //returns the consumed bytes
+{
+    const __m128i mask = _mm_set1_epi8 (0x0f);
+    uword i = 0;
+    for (; i + 16 <= sz; i += 16, dst += 32) {
+        __m128i v  = _mm_loadu_si128 ((const __m128i*) (src + i));
+        __m128i hi = _mm_and_si128 (_mm_srli_epi16 (v, 4), mask);
+        __m128i lo = _mm_and_si128 (v, mask);
+        hi = hex_nibbles_to_ascii_sse2 (hi);
+        lo = hex_nibbles_to_ascii_sse2 (lo);
+        _mm_storeu_si128 ((__m128i*) dst, _mm_unpacklo_epi8 (hi, lo));
+        _mm_storeu_si128 ((__m128i*) (dst + 16), _mm_unpackhi_epi8 (hi, lo));
     }
-};
+    return i;
+}
 #endif
-
-static const char hex_lut[] = "0123456789abcdef";
-template<uword remaining>
-struct hex_unroll
+//------------------------------------------------------------------------------
+#if defined (MAL_HAS_AVX2_DISPATCH)
+MAL_TARGET_AVX2 inline uword hex_avx2 (char* dst, const u8* src, uword sz)      //returns the consumed bytes
 {
-    inline static const u8* convert (char* dst, const u8* src)
-    {
-        *dst++ = hex_lut[(*src) >> 4];
-        *dst++ = hex_lut[(*src) &  15];
-        return hex_unroll<remaining - 1>::convert (dst, ++src);
+    const __m256i mask = _mm256_set1_epi8 (0x0f);
+    const __m256i lut  = _mm256_setr_epi8(
+        '0', '1', '2', '3', '4', '5', '6', '7',
+        '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+        '0', '1', '2', '3', '4', '5', '6', '7',
+        '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'
+        );
+    uword i = 0;
+    for (; i + 32 <= sz; i += 32, dst += 64) {
+        __m256i v  = _mm256_loadu_si256 ((const __m256i*) (src + i));
+        __m256i hi = _mm256_and_si256 (_mm256_srli_epi16 (v, 4), mask);
+        __m256i lo = _mm256_and_si256 (v, mask);
+        hi = _mm256_shuffle_epi8 (lut, hi);
+        lo = _mm256_shuffle_epi8 (lut, lo);
+        __m256i a = _mm256_unpacklo_epi8 (hi, lo);                              //unpack works per 128-bit lane: fix the order
+        __m256i b = _mm256_unpackhi_epi8 (hi, lo);
+        _mm256_storeu_si256(
+            (__m256i*) dst, _mm256_permute2x128_si256 (a, b, 0x20)
+            );
+        _mm256_storeu_si256(
+            (__m256i*) (dst + 32), _mm256_permute2x128_si256 (a, b, 0x31)
+            );
     }
-};
-
-template<>
-struct hex_unroll<0>
+    return i;
+}
+#endif
+//------------------------------------------------------------------------------
+inline void hex (char* dst, const u8* src, uword sz)
 {
-    inline static const u8* convert (char* dst, const u8* src)
-    {
-        return src;
+    uword done = 0;
+#if defined (MAL_HAS_AVX2_DISPATCH)
+    if (cpu_has_avx2()) {
+        done = hex_avx2 (dst, src, sz);
     }
-};
-
+#endif
+#if defined (MAL_HAS_SSE2)
+    done += hex_sse2 (dst + (done * 2), src + done, sz - done);
+#endif
+    hex_scalar (dst + (done * 2), src + done, sz - done);
+}
+//------------------------------------------------------------------------------
+inline void base64_triplet (char* dst, const u8* src)
+{
+    u32 v = (((u32) src[0]) << 16) | (((u32) src[1]) << 8) | src[2];
+    dst[0] = base64_lut[(v >> 18) & 63];
+    dst[1] = base64_lut[(v >> 12) & 63];
+    dst[2] = base64_lut[(v >> 6) & 63];
+    dst[3] = base64_lut[v & 63];
+}
+//------------------------------------------------------------------------------
+inline uword base64 (char* dst, const u8* src, uword sz)                        //returns the written chars
+{
+    uword triplets = sz / 3;
+    for (uword i = 0; i < triplets; ++i) {
+        base64_triplet (dst + (i * 4), src + (i * 3));
+    }
+    uword rem = sz - (triplets * 3);
+    if (rem == 0) {
+        return triplets * 4;
+    }
+    u8 last[3] = { 0, 0, 0 };
+    last[0]    = src[triplets * 3];
+    last[1]    = (rem == 2) ? src[(triplets * 3) + 1] : 0;
+    char* tail = dst + (triplets * 4);
+    base64_triplet (tail, last);
+    tail[3]    = '=';
+    tail[2]    = (rem == 2) ? tail[2] : '=';
+    return (triplets + 1) * 4;
+}
+//------------------------------------------------------------------------------
 } //detail
 //------------------------------------------------------------------------------
 class byte_stream_convert
 {
-    public:
-
-    static inline void execute (output& o, const u8* mem, uword sz)
+public:
+    //--------------------------------------------------------------------------
+    static const uword chunk_chars = 2048;
+    //--------------------------------------------------------------------------
+    static inline void hex (render_buffer& o, const u8* mem, uword sz)
     {
-
-        static const uword unroll_bits = 4;
-        static const uword unroll_mask = (1 << unroll_bits) - 1;
-        static const uword unroll_size = 1 << unroll_bits;
-
+        static const uword chunk_bytes = chunk_chars / 2;
         assert (mem);
-
-        char buff[unroll_size * 2];
-
-        uword end = sz >> unroll_bits;
-        for (uword i = 0; i < end; ++i) {
-            mem = detail::hex_unroll<unroll_size>::convert (buff, mem);
-            o.write (buff, sizeof buff);
+        char buff[chunk_chars];
+        while (sz) {
+            uword bytes = (sz < chunk_bytes) ? sz : chunk_bytes;
+            detail::hex (buff, mem, bytes);
+            o.write (buff, bytes * 2);
+            mem += bytes;
+            sz  -= bytes;
         }
-        end = sz & unroll_mask;
-        for (uword i = 0; i < end; ++i) {
-            mem = detail::hex_unroll<1>::convert (buff, mem);
-            o.write (buff, 2);
+    }
+    //--------------------------------------------------------------------------
+    static inline void base64 (render_buffer& o, const u8* mem, uword sz)
+    {
+        static const uword chunk_bytes = (chunk_chars / 4) * 3;
+        assert (mem);
+        char buff[chunk_chars];
+        while (sz) {
+            uword bytes = (sz < chunk_bytes) ? sz : chunk_bytes;
+            o.write (buff, detail::base64 (buff, mem, bytes));
+            mem += bytes;
+            sz  -= bytes;
         }
     }
+    //--------------------------------------------------------------------------
 }; //class byte_stream
 //------------------------------------------------------------------------------
 }} //namespaces
@@ -0,0 +1,208 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_SLICE_COMPRESSOR_HPP_
+#define MAL_LOG_SLICE_COMPRESSOR_HPP_
+
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/chrono.hpp>
+#include <mal_log/util/file.hpp>
+#include <mal_log/util/lz4_frame.hpp>
+#include <mal_log/log_file_register.hpp>
+#include <mal_log/timestamp.hpp>
+
+namespace mal {
+
+// Compresses closed file slices to LZ4 frames, incrementally, so it can be run
+// on the idle windows of the thread doing the I/O.
+//
+// When a slice is done the original is removed and its entry on the rotation
+// list renamed. If rotation deleted the source file while it was being
+// compressed the compressed output is removed too, so the files on disk match
+// the rotation list.
+//------------------------------------------------------------------------------
+class slice_compressor
+{
+public:
+    //--------------------------------------------------------------------------
+    bool init()
+    {
+        try {
+            m_chunk.resize (lz4::block_max);
+        }
+        catch (...) {
+            return false;
+        }
+        return m_lz4.init();
+    }
+    //--------------------------------------------------------------------------
+    void free()                                                                 //disables it
+    {
+        cancel();
+        m_pending.clear();
+        std::vector<char>().swap (m_chunk);
+        m_lz4.free();
+    }
+    //--------------------------------------------------------------------------
+    bool enabled() const
+    {
+        return m_chunk.size() != 0;
+    }
+    //--------------------------------------------------------------------------
+    void push (const char* closed_file)
+    {
+        try {
+            m_pending.push_back (closed_file);
+        }
+        catch (...) {}                                                          //the file just stays uncompressed
+    }
+    //--------------------------------------------------------------------------
+    void forget (const char* file)                                              //for files about to be deleted by someone else
+    {
+        for (auto it = m_pending.begin(); it != m_pending.end(); ++it) {
+            if (*it == file) {
+                m_pending.erase (it);
+                return;
+            }
+        }
+        if (m_in.is_open() && m_src == file) {
+            cancel();
+        }
+    }
+    //--------------------------------------------------------------------------
+    bool has_work() const
+    {
+        return m_in.is_open() || !m_pending.empty();
+    }
+    //--------------------------------------------------------------------------
+    bool run (log_file_register& reg, u64 budget_ns)                            //returns if there is work left
+    {
+        u64 deadline = get_ns_timestamp() + budget_ns;
+        while (has_work()) {
+            if (!m_in.is_open() && !start_next()) {
+                continue;
+            }
+            m_in.read (&m_chunk[0], m_chunk.size());
+            m_lz4.write (m_out, &m_chunk[0], (uword) m_in.gcount());
+            if (m_in.eof()) {
+                finish (reg);
+            }
+            else if (!m_in.good() || !m_out.good()) {
+                cancel();
+            }
+            if (timestamp_is_expired (get_ns_timestamp(), deadline)) {
+                break;
+            }
+        }
+        return has_work();
+    }
+    //--------------------------------------------------------------------------
+    void cancel()                                                               //drops the slice in progress, the original is kept
+    {
+        if (m_in.is_open()) {
+            m_in.close();
+            m_out.close();
+            std::remove (m_dst.c_str());
+        }
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    bool start_next()
+    {
+        try {
+            m_src = m_pending.front();
+            m_dst = m_src + lz4::file_extension;
+        }
+        catch (...) {
+            m_pending.pop_front();
+            return false;
+        }
+        m_pending.pop_front();
+        m_in.clear();
+        m_in.open (m_src.c_str(), std::ios::in | std::ios::binary);
+        if (!m_in.is_open()) {
+            return false;                                                       //rotated away before starting
+        }
+        if (!m_out.open (m_dst.c_str(), true)) {
+            m_in.close();
+            m_out.close();
+            return false;
+        }
+        m_lz4.begin (m_out);
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    void finish (log_file_register& reg)
+    {
+        m_lz4.end (m_out);
+        m_out.close();
+        m_in.close();
+        if (m_out.failed()) {
+            std::remove (m_dst.c_str());
+            return;
+        }
+        if (reg.rotates() &&
+            !reg.rotation_list_rename (m_src.c_str(), m_dst.c_str())
+            ) {
+            /* not on the rotation list: either rotated away while being
+               compressed or never tracked (e.g. first file of the run) */
+            if (std::remove (m_src.c_str()) != 0) {
+                std::remove (m_dst.c_str());
+            }
+            return;
+        }
+        std::remove (m_src.c_str());
+    }
+    //--------------------------------------------------------------------------
+    std::deque<std::string> m_pending;
+    std::string             m_src;
+    std::string             m_dst;
+    std::ifstream           m_in;
+    file                    m_out;
+    lz4_frame_writer        m_lz4;
+    std::vector<char>       m_chunk;
+};
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_SLICE_COMPRESSOR_HPP_ */
@@ -0,0 +1,275 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_SLICE_PREOPENER_HPP_
+#define MAL_LOG_SLICE_PREOPENER_HPP_
+
+#include <cassert>
+#include <cstdio>
+#include <deque>
+#include <string>
+
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/thread.hpp>
+#include <mal_log/util/thread_setup.hpp>
+#include <mal_log/util/file.hpp>
+
+namespace mal {
+
+// Helper thread taking the slow filesystem calls of file slicing out of the
+// thread doing the I/O.
+//
+// The next slice is requested when the current one is close to its size limit
+// and opened here. When it's time to slice "take" just swaps the file handles.
+// The old slice is handed over with "retire", to be (synced and) closed here.
+// Rotated away files are deleted here too.
+//
+// If "take" is called before the file is opened it waits for it, which is
+// never worse than opening it on the calling thread.
+//------------------------------------------------------------------------------
+class slice_preopener
+{
+public:
+    //--------------------------------------------------------------------------
+    slice_preopener()
+    {
+        m_binary         = false;
+        m_stop           = false;
+        m_active         = false;
+        m_requested      = false;
+        m_open_pending   = false;
+        m_retire_pending = false;
+        m_retire_sync    = false;
+        thread_cfg_set_defaults (m_thread_cfg);
+    }
+    //--------------------------------------------------------------------------
+    ~slice_preopener()
+    {
+        stop();
+    }
+    //--------------------------------------------------------------------------
+    void set_thread_cfg (const thread_cfg& c)                                   //to be called before "init"
+    {
+        m_thread_cfg = c;
+    }
+    //--------------------------------------------------------------------------
+    bool init (bool binary)
+    {
+        assert (!m_active);
+        m_binary = binary;
+        m_stop   = false;
+        try {
+            m_thread = th::thread ([this]() { this->thread(); });
+        }
+        catch (...) {
+            return false;
+        }
+        m_active = true;
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    void stop()                                                                 //completes the pending work, an unused preopened file is removed
+    {
+        if (!m_active) {
+            return;
+        }
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            m_stop = true;
+        }
+        m_work_cond.notify_one();
+        m_thread.join();
+        cancel();
+        m_active = false;
+    }
+    //--------------------------------------------------------------------------
+    bool active() const
+    {
+        return m_active;
+    }
+    //--------------------------------------------------------------------------
+    bool requested() const
+    {
+        return m_requested;
+    }
+    //--------------------------------------------------------------------------
+    bool request (const char* filename)
+    {
+        assert (m_active && !m_requested);
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            try {
+                m_open_name = filename;
+            }
+            catch (...) {
+                return false;
+            }
+            m_open_pending = true;
+        }
+        m_work_cond.notify_one();
+        m_requested = true;
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    bool take (file& dst)                                                       //on success "dst" has to be closed
+    {
+        assert (m_requested && !dst.is_open());
+        m_requested = false;
+        th::unique_lock<th::mutex> lock (m_lock);
+        m_done_cond.wait (lock, [this]() { return !m_open_pending; });
+        if (!m_next.good()) {
+            m_next.close();
+            return false;
+        }
+        dst.swap (m_next);
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    void cancel()                                                               //drops the requested file, if any
+    {
+        if (!m_requested) {
+            return;
+        }
+        m_requested = false;
+        th::unique_lock<th::mutex> lock (m_lock);
+        m_done_cond.wait (lock, [this]() { return !m_open_pending; });
+        if (m_next.is_open()) {
+            m_next.close();
+            std::remove (m_open_name.c_str());
+        }
+    }
+    //--------------------------------------------------------------------------
+    void retire (file& f, bool sync)                                            //"f" is returned closed
+    {
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            m_done_cond.wait (lock, [this]() { return !m_retire_pending; });
+            m_retired.swap (f);
+            m_retire_pending = true;
+            m_retire_sync    = sync;
+        }
+        m_work_cond.notify_one();
+    }
+    //--------------------------------------------------------------------------
+    void erase (const char* filename)
+    {
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            try {
+                m_erase.push_back (filename);
+            }
+            catch (...) {
+                lock.unlock();
+                std::remove (filename);
+                return;
+            }
+        }
+        m_work_cond.notify_one();
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    void thread()
+    {
+        setup_this_thread (m_thread_cfg);
+        th::unique_lock<th::mutex> lock (m_lock);
+        while (true) {
+            m_work_cond.wait (lock, [this]() {
+                return m_stop
+                    || m_open_pending
+                    || m_retire_pending
+                    || !m_erase.empty();
+            });
+            if (m_retire_pending) {
+                file f;
+                f.swap (m_retired);
+                bool sync = m_retire_sync;
+                lock.unlock();
+                if (sync) {
+                    f.sync();
+                }
+                f.close();
+                lock.lock();
+                m_retire_pending = false;
+                m_done_cond.notify_all();
+                continue;
+            }
+            if (m_open_pending) {
+                file f;
+                lock.unlock();
+                f.open (m_open_name.c_str(), m_binary);                         //"m_open_name" is untouched until "take"
+                lock.lock();
+                m_next.swap (f);
+                m_open_pending = false;
+                m_done_cond.notify_all();
+                continue;
+            }
+            if (!m_erase.empty()) {
+                std::string name;
+                name.swap (m_erase.front());
+                m_erase.pop_front();
+                lock.unlock();
+                std::remove (name.c_str());
+                lock.lock();
+                continue;
+            }
+            if (m_stop) {
+                return;
+            }
+        }
+    }
+    //--------------------------------------------------------------------------
+    std::string             m_open_name;
+    std::deque<std::string> m_erase;
+    file                    m_next;
+    file                    m_retired;
+    th::mutex               m_lock;
+    th::condition_variable  m_work_cond;
+    th::condition_variable  m_done_cond;
+    th::thread              m_thread;
+    thread_cfg              m_thread_cfg;
+    bool                    m_binary;
+    bool                    m_stop;
+    bool                    m_active;
+    bool                    m_requested;                                        //only accessed from the calling thread
+    bool                    m_open_pending;
+    bool                    m_retire_pending;
+    bool                    m_retire_sync;
+};
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_SLICE_PREOPENER_HPP_ */
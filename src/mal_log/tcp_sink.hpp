@@ -0,0 +1,460 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_TCP_SINK_HPP_
+#define MAL_LOG_TCP_SINK_HPP_
+
+#include <mal_log/util/system.hpp>
+
+#if defined (MAL_UNIX_LIKE)
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/atomic.hpp>
+#include <mal_log/util/thread.hpp>
+#include <mal_log/util/thread_setup.hpp>
+#include <mal_log/util/chrono.hpp>
+#include <mal_log/util/file.hpp>
+#include <mal_log/timestamp.hpp>
+#include <mal_log/sink.hpp>
+#include <mal_log/cfg.hpp>
+#include <mal_log/log_file_register.hpp>
+
+namespace mal {
+
+// Streams the rendered batches to a TCP collector.
+//
+// The logger thread only appends to a bounded memory buffer. A network thread
+// owned by the sink connects, sends the buffer in big chunks and reconnects
+// when needed. When the buffer is full (slow or unreachable peer) the data
+// goes to "spill" files on disk, named like the log files. Once the
+// connection catches up the spill files are replayed in order and deleted,
+// then the memory buffer is used again. The stream order is always kept.
+//
+// Data already handed to the kernel when a connection breaks is lost, there
+// are no application level acknowledgements. The spill files still on disk
+// when the logger stops are left there (not replayed on the next run).
+//------------------------------------------------------------------------------
+class tcp_sink : public sink
+{
+public:
+    //--------------------------------------------------------------------------
+    static const uword chunk_bytes = 64 * 1024;
+    //--------------------------------------------------------------------------
+    tcp_sink()
+    {
+        m_fd           = -1;
+        m_spilling     = false;
+        m_stop         = false;
+        m_active       = false;
+        m_replay_offs  = 0;
+        m_spill_bytes  = 0;
+        m_dropped      = 0;
+        thread_cfg_set_defaults (m_thread_cfg);
+    }
+    //--------------------------------------------------------------------------
+    ~tcp_sink()
+    {
+        close();
+    }
+    //--------------------------------------------------------------------------
+    void set_thread_cfg (const thread_cfg& c)                                   //to be called before "init"
+    {
+        m_thread_cfg = c;
+    }
+    //--------------------------------------------------------------------------
+    bool init (const tcp_cfg& c, const std::string& default_folder, u64 ts_base)
+    {
+        assert (!m_active);
+        m_cfg = c;
+        set_severity (c.severity);
+        std::string folder = c.spill_folder.size() ?
+            c.spill_folder : default_folder;
+        if (!m_register.init(
+                0,
+                folder,
+                c.spill_prefix,
+                ".spill",
+                past_executions_file_list()
+                )) {
+            return false;
+        }
+        m_register.set_timestamp_base (ts_base);
+        m_stop = false;
+        try {
+            m_mem.reserve (m_cfg.memory_bytes);
+            m_thread = th::thread ([this]() { this->thread(); });
+        }
+        catch (...) {
+            return false;
+        }
+        m_active = true;
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    virtual void write (const sink_span* spans, uword count)
+    {
+        uword bytes = 0;
+        for (uword i = 0; i < count; ++i) {
+            bytes += spans[i].size;
+        }
+        th::unique_lock<th::mutex> lock (m_lock);
+        if (!m_spilling && m_mem.size() + bytes <= m_cfg.memory_bytes) {
+            for (uword i = 0; i < count; ++i) {
+                const char* d = spans[i].data;
+                m_mem.insert (m_mem.end(), d, d + spans[i].size);
+            }
+            lock.unlock();
+            m_cond.notify_one();
+            return;
+        }
+        m_spilling = true;
+        for (uword i = 0; i < count; ++i) {
+            spill (spans[i].data, spans[i].size);
+        }
+        lock.unlock();
+        m_cond.notify_one();
+    }
+    //--------------------------------------------------------------------------
+    virtual void flush()
+    {
+        th::unique_lock<th::mutex> lock (m_lock);
+        m_spill.flush();
+    }
+    //--------------------------------------------------------------------------
+    virtual void close()                                                        //tries to send the pending data for a while, spills the rest
+    {
+        if (!m_active) {
+            return;
+        }
+        {
+            th::unique_lock<th::mutex> lock (m_lock);
+            m_stop = true;
+        }
+        m_cond.notify_one();
+        m_thread.join();
+        m_spill.close();
+        m_active = false;
+    }
+    //--------------------------------------------------------------------------
+    uword dropped() const                                                       //bytes
+    {
+        return m_dropped;
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    struct spill_file {
+        std::string name;
+        uword       bytes;
+    };
+    //--------------------------------------------------------------------------
+    void spill (const char* d, uword size)                                      //with the lock held
+    {
+        if (!m_spill.is_open() || m_spill_bytes >= m_cfg.spill_file_bytes) {
+            new_spill_file();
+        }
+        if (!m_spill.good()) {
+            m_dropped = m_dropped + size;
+            return;
+        }
+        m_spill.write (d, size);
+        m_spill_bytes             += size;
+        m_spill_files.back().bytes = m_spill_bytes;
+    }
+    //--------------------------------------------------------------------------
+    void new_spill_file()                                                       //with the lock held
+    {
+        m_spill.close();
+        if (m_cfg.spill_max_files &&
+            m_spill_files.size() >= m_cfg.spill_max_files
+            ) {
+            uword victim = (m_replaying.size() &&
+                m_spill_files.front().name == m_replaying) ? 1 : 0;
+            if (victim < m_spill_files.size()) {
+                m_replay_offs = victim ? m_replay_offs : 0;                     //it belonged to the front file
+                std::remove (m_spill_files[victim].name.c_str());
+                m_dropped = m_dropped + m_spill_files[victim].bytes;
+                m_spill_files.erase (m_spill_files.begin() + victim);
+            }
+        }
+        using namespace ch;
+        u64 calendar_us = duration_cast<microseconds>(
+            system_clock::now().time_since_epoch()
+            ).count();
+        spill_file f;
+        f.name  = m_register.change_current_filename(
+            get_ns_timestamp(), calendar_us
+            );
+        f.bytes = 0;
+        m_spill_files.push_back (f);
+        m_spill_bytes = 0;
+        m_spill.open (f.name.c_str(), true);
+    }
+    //--------------------------------------------------------------------------
+    void thread()
+    {
+        setup_this_thread (m_thread_cfg);
+        std::vector<char> out;
+        out.reserve (m_cfg.memory_bytes);
+        th::unique_lock<th::mutex> lock (m_lock);
+        ch::steady_clock::time_point next_connect;
+        while (true) {
+            bool stop = m_stop;
+            if (m_fd < 0) {
+                if (stop || ch::steady_clock::now() < next_connect) {
+                    if (stop) {
+                        break;
+                    }
+                    m_cond.wait_until (lock, next_connect);
+                    continue;
+                }
+                lock.unlock();
+                connect();
+                lock.lock();
+                next_connect = ch::steady_clock::now() + ch::seconds (1);
+                continue;
+            }
+            if (!m_mem.empty()) {
+                out.swap (m_mem);
+                lock.unlock();
+                uword sent = send_all (out.data(), out.size(), stop);
+                lock.lock();
+                bool incomplete = sent < out.size();
+                if (incomplete) {                                               //back in front of the newer data
+                    m_mem.insert (m_mem.begin(), out.begin() + sent, out.end());
+                }
+                out.clear();
+                if (stop && incomplete && m_fd >= 0) {
+                    break;                                                      //shutdown deadline
+                }
+                continue;
+            }
+            if (!m_spill_files.empty()) {
+                if (stop) {
+                    break;                                                      //left on disk
+                }
+                if (m_spill_files.size() == 1 && m_spill.is_open()) {
+                    m_spill.close();                                            //the next spill goes to a new file
+                }
+                m_replaying = m_spill_files.front().name;
+                lock.unlock();
+                bool done = replay (m_replaying.c_str(), stop);
+                lock.lock();
+                if (done) {
+                    std::remove (m_replaying.c_str());
+                    if (m_spill_files.size() &&
+                        m_spill_files.front().name == m_replaying
+                        ) {
+                        m_spill_files.pop_front();
+                    }
+                    m_spilling = !m_spill_files.empty();
+                }
+                m_replaying.clear();
+                continue;
+            }
+            if (stop) {
+                break;
+            }
+            m_cond.wait (lock, [this]() {
+                return m_stop || !m_mem.empty() || !m_spill_files.empty();
+            });
+        }
+        if (!m_mem.empty()) {                                                   //not sent on time
+            m_spilling = true;
+            spill (m_mem.data(), m_mem.size());
+            m_mem.clear();
+        }
+        lock.unlock();
+        disconnect();
+    }
+    //--------------------------------------------------------------------------
+    bool replay (const char* name, bool stop)                                   //returns if the whole file was sent
+    {
+        std::FILE* f = std::fopen (name, "rb");
+        if (!f) {
+            m_replay_offs = 0;
+            return true;                                                        //nothing to do
+        }
+        bool done = false;
+        if (std::fseek (f, (long) m_replay_offs, SEEK_SET) == 0) {
+            std::vector<char> buf (chunk_bytes);
+            while (true) {
+                uword rd = std::fread (buf.data(), 1, buf.size(), f);
+                if (rd == 0) {
+                    done = true;
+                    break;
+                }
+                uword sent     = send_all (buf.data(), rd, stop);
+                m_replay_offs += sent;
+                if (sent < rd) {
+                    break;
+                }
+            }
+        }
+        std::fclose (f);
+        if (done) {
+            m_replay_offs = 0;
+        }
+        return done;
+    }
+    //--------------------------------------------------------------------------
+    uword send_all (const char* d, uword size, bool stop)                       //returns the bytes sent
+    {
+        static const int poll_ms  = 100;
+        static const int stop_max = 10;                                         //polls after being stopped
+        int   stop_polls = 0;
+        uword sent       = 0;
+        while (sent < size && m_fd >= 0) {
+            ssize_t r = ::send (m_fd, d + sent, size - sent, MSG_NOSIGNAL);
+            if (r > 0) {
+                sent += (uword) r;
+                continue;
+            }
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                stop = stop || stopping();
+                if (stop && ++stop_polls > stop_max) {
+                    break;
+                }
+                pollfd p;
+                p.fd     = m_fd;
+                p.events = POLLOUT;
+                ::poll (&p, 1, poll_ms);
+                continue;
+            }
+            disconnect();
+        }
+        return sent;
+    }
+    //--------------------------------------------------------------------------
+    bool stopping()
+    {
+        th::unique_lock<th::mutex> lock (m_lock);
+        return m_stop;
+    }
+    //--------------------------------------------------------------------------
+    void connect()
+    {
+        addrinfo hints;
+        std::memset (&hints, 0, sizeof hints);
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res     = nullptr;
+        if (::getaddrinfo(
+            m_cfg.host.c_str(), m_cfg.port.c_str(), &hints, &res
+            ) != 0) {
+            return;
+        }
+        for (addrinfo* a = res; a && m_fd < 0; a = a->ai_next) {
+            int fd = ::socket (a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            int flags = ::fcntl (fd, F_GETFL, 0);
+            ::fcntl (fd, F_SETFL, flags | O_NONBLOCK);
+            ::fcntl (fd, F_SETFD, FD_CLOEXEC);
+            int r = ::connect (fd, a->ai_addr, a->ai_addrlen);
+            if (r != 0 && errno == EINPROGRESS) {
+                pollfd p;
+                p.fd     = fd;
+                p.events = POLLOUT;
+                int       err = -1;
+                socklen_t len = sizeof err;
+                if (::poll (&p, 1, 1000) == 1 &&
+                    ::getsockopt (fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0
+                    ) {
+                    r = err ? -1 : 0;
+                }
+            }
+            if (r == 0) {
+                m_fd = fd;
+            }
+            else {
+                ::close (fd);
+            }
+        }
+        ::freeaddrinfo (res);
+    }
+    //--------------------------------------------------------------------------
+    void disconnect()
+    {
+        if (m_fd >= 0) {
+            ::close (m_fd);
+            m_fd = -1;
+        }
+    }
+    //--------------------------------------------------------------------------
+    tcp_cfg                  m_cfg;
+    log_file_register        m_register;
+    std::vector<char>        m_mem;
+    std::deque<spill_file>   m_spill_files;
+    std::string              m_replaying;
+    file                     m_spill;
+    th::mutex                m_lock;
+    th::condition_variable   m_cond;
+    th::thread               m_thread;
+    thread_cfg               m_thread_cfg;
+    mo_relaxed_atomic<uword> m_dropped;
+    uword                    m_spill_bytes;
+    u64                      m_replay_offs;
+    int                      m_fd;
+    bool                     m_spilling;
+    bool                     m_stop;
+    bool                     m_active;
+};
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_UNIX_LIKE */
+
+#endif /* MAL_LOG_TCP_SINK_HPP_ */
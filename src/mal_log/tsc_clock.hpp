@@ -0,0 +1,198 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_TSC_CLOCK_HPP_
+#define MAL_LOG_TSC_CLOCK_HPP_
+
+#include <cstring>
+
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/atomic.hpp>
+#include <mal_log/timestamp.hpp>
+
+namespace mal {
+
+// Converts "get_tsc_timestamp" ticks to "get_ns_timestamp" nanoseconds.
+//
+// The producers store raw ticks relative to "tick_base", which costs a few
+// cycles instead of a clock call. The rate is measured against the steady
+// clock at "init" (briefly) and refined on each "calibrate" call from the
+// first sample, so its precision improves with the uptime. Each calibration
+// also moves the conversion anchor to the newest sample.
+//
+// "calibrate" is called from one thread while the formatting threads convert
+// concurrently, the conversion data is published through a seqlock.
+//------------------------------------------------------------------------------
+class tsc_clock
+{
+public:
+    //--------------------------------------------------------------------------
+    tsc_clock()
+    {
+        m_seq         = 0;
+        m_tick_base   = 0;
+        m_ns_base     = 0;
+        m_first_ticks = 0;
+        m_first_ns    = 0;
+        m_anchor_ticks.store (0, mo_relaxed);
+        m_anchor_ns.store (0, mo_relaxed);
+        m_rate.store (0, mo_relaxed);
+        m_enabled = false;
+    }
+    //--------------------------------------------------------------------------
+    bool init (u64 ns_base)                                                     //false if the counter isn't usable
+    {
+        m_enabled = false;
+        if (!tsc_is_invariant()) {
+            return false;
+        }
+        m_ns_base   = ns_base;
+        m_tick_base = get_tsc_timestamp();
+        sample (m_first_ticks, m_first_ns);
+        u64 ticks, ns;
+        do {                                                                    //first estimation, refined later
+            sample (ticks, ns);
+        }
+        while (ns - m_first_ns < init_sample_ns);
+        if (ticks == m_first_ticks) {
+            return false;
+        }
+        publish (ticks, ns);
+        m_enabled = true;
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    bool enabled() const
+    {
+        return m_enabled;
+    }
+    //--------------------------------------------------------------------------
+    u64 tick_base() const
+    {
+        return m_tick_base;
+    }
+    //--------------------------------------------------------------------------
+    void calibrate()
+    {
+        if (!m_enabled) {
+            return;
+        }
+        u64 ticks, ns;
+        sample (ticks, ns);
+        if (ticks != m_first_ticks) {
+            publish (ticks, ns);
+        }
+    }
+    //--------------------------------------------------------------------------
+    u64 to_ns (u64 ticks) const                                                 //"ticks" relative to "tick_base", result relative to "ns_base"
+    {
+        u64    anchor_ticks, anchor_ns;
+        double rate;
+        u32    seq;
+        do {
+            seq = m_seq.load (mo_acquire);
+            anchor_ticks = m_anchor_ticks.load (mo_relaxed);
+            anchor_ns    = m_anchor_ns.load (mo_relaxed);
+            rate         = from_bits (m_rate.load (mo_relaxed));
+            at::atomic_thread_fence (mo_acquire);
+        }
+        while ((seq & 1) || seq != m_seq.load (mo_relaxed));
+        double delta = (double) (i64) (ticks - anchor_ticks) * rate;
+        return anchor_ns + (u64) (i64) delta;
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    static const u64 init_sample_ns = 2 * 1000 * 1000;
+    //--------------------------------------------------------------------------
+    void sample (u64& ticks, u64& ns) const                                     //the tightest of a few reads
+    {
+        u64 best = (u64) -1;
+        ticks    = 0;
+        ns       = 0;
+        for (uword i = 0; i < 5; ++i) {
+            u64 t0 = get_tsc_timestamp();
+            u64 n  = get_ns_timestamp();
+            u64 t1 = get_tsc_timestamp();
+            if (t1 - t0 < best) {
+                best  = t1 - t0;
+                ticks = t0 + ((t1 - t0) / 2) - m_tick_base;
+                ns    = n - m_ns_base;
+            }
+        }
+    }
+    //--------------------------------------------------------------------------
+    void publish (u64 ticks, u64 ns)
+    {
+        double rate = (double) (ns - m_first_ns) /
+            (double) (ticks - m_first_ticks);
+        u32 seq = m_seq.load (mo_relaxed);
+        m_seq.store (seq + 1, mo_relaxed);
+        at::atomic_thread_fence (mo_release);
+        m_anchor_ticks.store (ticks, mo_relaxed);
+        m_anchor_ns.store (ns, mo_relaxed);
+        m_rate.store (to_bits (rate), mo_relaxed);
+        m_seq.store (seq + 2, mo_release);
+    }
+    //--------------------------------------------------------------------------
+    static u64 to_bits (double v)
+    {
+        u64 r;
+        std::memcpy (&r, &v, sizeof r);
+        return r;
+    }
+    //--------------------------------------------------------------------------
+    static double from_bits (u64 v)
+    {
+        double r;
+        std::memcpy (&r, &v, sizeof r);
+        return r;
+    }
+    //--------------------------------------------------------------------------
+    atomic_u32 m_seq;
+    atomic_u64 m_anchor_ticks;
+    atomic_u64 m_anchor_ns;
+    atomic_u64 m_rate;                                                          //ns per tick, double bits
+    u64        m_tick_base;
+    u64        m_ns_base;
+    u64        m_first_ticks;
+    u64        m_first_ns;
+    bool       m_enabled;
+};
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_TSC_CLOCK_HPP_ */
@@ -0,0 +1,80 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_CPU_FEATURES_HPP_
+#define MAL_LOG_CPU_FEATURES_HPP_
+
+#include <mal_log/util/system.hpp>
+
+// MAL_HAS_SSE2: SSE2 kernels can be compiled unconditionally (x86_64 baseline)
+//
+// MAL_HAS_AVX2_DISPATCH: AVX2 kernels can be compiled through function target
+//     attributes and selected at runtime. Not available on Visual Studio, as it
+//     has no way to compile AVX2 code on a translation unit without "/arch".
+//
+// Define MAL_NO_SIMD to force the scalar fallbacks everywhere.
+
+#if !defined (MAL_NO_SIMD)
+    #if defined (__SSE2__) || defined (_M_X64) || \
+        (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define MAL_HAS_SSE2 1
+        #include <emmintrin.h>
+    #endif
+    #if defined (MAL_HAS_SSE2) && \
+        (defined (__clang__) || \
+            (defined (__GNUC__) && \
+                (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+        #define MAL_HAS_AVX2_DISPATCH 1
+        #define MAL_TARGET_AVX2 __attribute__ ((target ("avx2")))
+        #include <immintrin.h>
+    #endif
+#endif
+
+namespace mal {
+//------------------------------------------------------------------------------
+inline bool cpu_has_avx2()
+{
+#if defined (MAL_HAS_AVX2_DISPATCH)
+    static const bool has = __builtin_cpu_supports ("avx2") ? true : false;
+    return has;
+#else
+    return false;
+#endif
+}
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_CPU_FEATURES_HPP_ */
@@ -0,0 +1,210 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_FILE_HPP_
+#define MAL_LOG_FILE_HPP_
+
+#include <cassert>
+#include <cstdio>
+#include <mal_log/util/system.hpp>
+#if defined (MAL_UNIX_LIKE)
+    #include <unistd.h>
+    #include <fcntl.h>
+#elif defined (MAL_WINDOWS)
+    #include <io.h>
+#endif
+#include <mal_log/util/integer.hpp>
+
+namespace mal {
+
+// Minimal C stdio file wrapper. The backend writes big contiguous chunks, so it
+// doesn't need the iostream machinery (locales, sentries, virtual calls on
+// each write). Errors are sticky, as on iostreams.
+//------------------------------------------------------------------------------
+class file
+{
+public:
+    //--------------------------------------------------------------------------
+    file()
+    {
+        m_f     = nullptr;
+        m_error = false;
+    }
+    //--------------------------------------------------------------------------
+    ~file()
+    {
+        close();
+    }
+    //--------------------------------------------------------------------------
+    bool open (const char* path, bool binary = false)                           //truncates
+    {
+        close();
+#ifdef MAL_WINDOWS
+    #pragma warning(disable: 4996)
+#endif
+        m_f = std::fopen (path, binary ? "wb" : "w");
+#ifdef MAL_WINDOWS
+    #pragma warning(default: 4996)
+#endif
+        m_error = (m_f == nullptr);
+        return !m_error;
+    }
+    //--------------------------------------------------------------------------
+    bool open_existing (const char* path, bool binary = false)                  //doesn't truncate, writes from the start
+    {
+        close();
+#ifdef MAL_WINDOWS
+    #pragma warning(disable: 4996)
+#endif
+        m_f = std::fopen (path, binary ? "r+b" : "r+");
+#ifdef MAL_WINDOWS
+    #pragma warning(default: 4996)
+#endif
+        m_error = (m_f == nullptr);
+        return !m_error;
+    }
+    //--------------------------------------------------------------------------
+    void preallocate (u64 bytes)                                                //best effort, Linux only. Leaves a zeroed file of "bytes" size
+    {
+        assert (m_f);
+#if defined (__linux__)
+        int fd = fileno (m_f);
+        if (::ftruncate (fd, (off_t) bytes) != 0) {
+            return;
+        }
+    #if defined (FALLOC_FL_ZERO_RANGE)
+        if (::fallocate (fd, FALLOC_FL_ZERO_RANGE, 0, (off_t) bytes) == 0) {
+            return;
+        }
+    #endif
+        ::fallocate (fd, 0, 0, (off_t) bytes);                                  //no zeroing of previous contents
+#else
+        (void) bytes;
+#endif
+    }
+    //--------------------------------------------------------------------------
+    bool truncate_here()                                                        //drops everything after the write position. Not sticky
+    {
+        flush();
+        if (!m_f) {
+            return false;
+        }
+#if defined (MAL_UNIX_LIKE)
+        off_t pos = ftello (m_f);
+        return pos >= 0 && ::ftruncate (fileno (m_f), pos) == 0;
+#elif defined (MAL_WINDOWS)
+        __int64 pos = _ftelli64 (m_f);
+        return pos >= 0 && _chsize_s (_fileno (m_f), pos) == 0;
+#else
+        return false;
+#endif
+    }
+    //--------------------------------------------------------------------------
+    bool is_open() const
+    {
+        return m_f != nullptr;
+    }
+    //--------------------------------------------------------------------------
+    void close()
+    {
+        if (m_f) {
+            m_error |= (std::fclose (m_f) != 0);
+            m_f      = nullptr;
+        }
+    }
+    //--------------------------------------------------------------------------
+    bool good() const
+    {
+        return m_f && !m_error;
+    }
+    //--------------------------------------------------------------------------
+    bool failed() const                                                         //also valid after "close"
+    {
+        return m_error;
+    }
+    //--------------------------------------------------------------------------
+    void write (const void* d, uword sz)                                        //fails (no-op) when not open, e.g. a slice couldn't be opened
+    {
+        if (!m_f) {
+            m_error = true;
+            return;
+        }
+        m_error |= (std::fwrite (d, 1, sz, m_f) != sz);
+    }
+    //--------------------------------------------------------------------------
+    void flush()
+    {
+        if (m_f) {
+            m_error |= (std::fflush (m_f) != 0);
+        }
+    }
+    //--------------------------------------------------------------------------
+    bool sync()                                                                 //flush + commit to the storage device. Not sticky
+    {
+        flush();
+        if (!m_f) {
+            return false;
+        }
+#if defined (MAL_UNIX_LIKE)
+        return ::fdatasync (fileno (m_f)) == 0;
+#elif defined (MAL_WINDOWS)
+        return _commit (_fileno (m_f)) == 0;
+#else
+        return true;
+#endif
+    }
+    //--------------------------------------------------------------------------
+    void swap (file& other)
+    {
+        std::FILE* f  = m_f;
+        bool       e  = m_error;
+        m_f           = other.m_f;
+        m_error       = other.m_error;
+        other.m_f     = f;
+        other.m_error = e;
+    }
+    //--------------------------------------------------------------------------
+private:
+    file (const file&);
+    file& operator= (const file&);
+    //--------------------------------------------------------------------------
+    std::FILE* m_f;
+    bool       m_error;
+};
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_FILE_HPP_ */
@@ -0,0 +1,332 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_LZ4_FRAME_HPP_
+#define MAL_LOG_LZ4_FRAME_HPP_
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#include <mal_log/util/integer.hpp>
+
+// Dependency-free LZ4 frame encoder (compression only). Output can be read
+// with the standard "lz4" tools. The "sink" template parameter just needs a
+// "write (const void*, uword)" member function.
+//
+// The frame uses independent 64KB blocks without block or content checksums.
+// As every block can be decoded on its own, a truncated file (e.g. after a
+// crash) is readable up to its last complete block.
+//
+// The block compressor is a plain greedy single-probe hash matcher, it trades
+// ratio for speed like the reference "LZ4_compress_fast". Log data is very
+// repetitive, so this is enough to get good ratios.
+
+namespace mal {
+//------------------------------------------------------------------------------
+namespace lz4 {
+//------------------------------------------------------------------------------
+static const uword min_match     = 4;
+static const uword last_literals = 5;
+static const uword mflimit       = 12;
+static const uword max_offset    = 65535;
+static const uword hash_log      = 12;
+static const uword block_max     = 64 * 1024;
+static const char  file_extension[] = ".lz4";
+//------------------------------------------------------------------------------
+inline uword compress_bound (uword sz)
+{
+    return sz + (sz / 255) + 16;
+}
+//------------------------------------------------------------------------------
+inline u32 read32 (const u8* p)
+{
+    u32 v;
+    std::memcpy (&v, p, sizeof v);
+    return v;
+}
+//------------------------------------------------------------------------------
+inline void write_le32 (u8* p, u32 v)
+{
+    p[0] = (u8) v;
+    p[1] = (u8) (v >> 8);
+    p[2] = (u8) (v >> 16);
+    p[3] = (u8) (v >> 24);
+}
+//------------------------------------------------------------------------------
+inline u32 rotl32 (u32 v, unsigned r)
+{
+    return (v << r) | (v >> (32 - r));
+}
+//------------------------------------------------------------------------------
+inline u32 xxh32 (const u8* p, uword sz, u32 seed)
+{
+    static const u32 p1 = 2654435761U;
+    static const u32 p2 = 2246822519U;
+    static const u32 p3 = 3266489917U;
+    static const u32 p4 = 668265263U;
+    static const u32 p5 = 374761393U;
+
+    const u8* end = p + sz;
+    u32 h;
+    if (sz >= 16) {
+        u32 v1 = seed + p1 + p2;
+        u32 v2 = seed + p2;
+        u32 v3 = seed;
+        u32 v4 = seed - p1;
+        for (; p + 16 <= end; p += 16) {
+            v1 = rotl32 (v1 + (read32 (p) * p2), 13) * p1;
+            v2 = rotl32 (v2 + (read32 (p + 4) * p2), 13) * p1;
+            v3 = rotl32 (v3 + (read32 (p + 8) * p2), 13) * p1;
+            v4 = rotl32 (v4 + (read32 (p + 12) * p2), 13) * p1;
+        }
+        h = rotl32 (v1, 1) + rotl32 (v2, 7) + rotl32 (v3, 12) + rotl32 (v4, 18);
+    }
+    else {
+        h = seed + p5;
+    }
+    h += (u32) sz;
+    for (; p + 4 <= end; p += 4) {
+        h  = rotl32 (h + (read32 (p) * p3), 17) * p4;
+    }
+    for (; p < end; ++p) {
+        h  = rotl32 (h + (*p * p5), 11) * p1;
+    }
+    h ^= h >> 15;
+    h *= p2;
+    h ^= h >> 13;
+    h *= p3;
+    h ^= h >> 16;
+    return h;
+}
+//------------------------------------------------------------------------------
+inline u8* write_length (u8* dst, uword len)                                    //writes the length bytes following a token nibble (len >= 15)
+{
+    len -= 15;
+    for (; len >= 255; len -= 255) {
+        *dst++ = 255;
+    }
+    *dst++ = (u8) len;
+    return dst;
+}
+//------------------------------------------------------------------------------
+inline u8* write_sequence(
+    u8* dst, const u8* literals, uword lit_len, uword offset, uword match_len
+    )
+{
+    u8* token = dst++;
+    *token    = (u8) ((lit_len < 15 ? lit_len : 15) << 4);
+    if (lit_len >= 15) {
+        dst = write_length (dst, lit_len);
+    }
+    std::memcpy (dst, literals, lit_len);
+    dst += lit_len;
+    if (match_len == 0) {                                                       //last sequence: literals only
+        return dst;
+    }
+    *dst++ = (u8) offset;
+    *dst++ = (u8) (offset >> 8);
+    uword ml = match_len - min_match;
+    *token  |= (u8) (ml < 15 ? ml : 15);
+    if (ml >= 15) {
+        dst = write_length (dst, ml);
+    }
+    return dst;
+}
+//------------------------------------------------------------------------------
+// "dst" needs "compress_bound (sz)" bytes, "table" (1 << hash_log) entries.
+// returns the compressed size.
+inline uword compress_block (u8* dst, const u8* src, uword sz, u32* table)
+{
+    assert (sz <= block_max);
+    u8* const       dst_start = dst;
+    const u8* const iend      = src + sz;
+    const u8*       anchor    = src;
+
+    if (sz >= mflimit + 1) {
+        const u8* const match_limit = iend - last_literals;
+        const u8* const ilimit      = iend - mflimit;
+        const u8*       ip          = src;
+        uword           misses      = 0;
+
+        std::memset (table, 0, sizeof *table << hash_log);
+        while (ip <= ilimit) {
+            u32 seq  = read32 (ip);
+            u32 h    = (seq * 2654435761U) >> (32 - hash_log);
+            const u8* ref = src + table[h];
+            table[h] = (u32) (ip - src);
+
+            if (ref >= ip || (uword) (ip - ref) > max_offset ||
+                read32 (ref) != seq
+                ) {
+                ip += 1 + (misses++ >> 6);                                      //skip faster on incompressible data
+                continue;
+            }
+            misses = 0;
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+            const u8* m = ip + min_match;
+            const u8* r = ref + min_match;
+            while (m < match_limit && *m == *r) {
+                ++m;
+                ++r;
+            }
+            dst = write_sequence(
+                dst, anchor, ip - anchor, ip - ref, m - ip
+                );
+            anchor = ip = m;
+            if (ip <= ilimit) {
+                const u8* prev = ip - 2;
+                table[(read32 (prev) * 2654435761U) >> (32 - hash_log)] =
+                    (u32) (prev - src);
+            }
+        }
+    }
+    dst = write_sequence (dst, anchor, iend - anchor, 0, 0);
+    return dst - dst_start;
+}
+//------------------------------------------------------------------------------
+} //namespace lz4
+//------------------------------------------------------------------------------
+class lz4_frame_writer
+{
+public:
+    //--------------------------------------------------------------------------
+    static const uword frame_header_size = 7;
+    //--------------------------------------------------------------------------
+    lz4_frame_writer()
+    {
+        m_in_size = 0;
+    }
+    //--------------------------------------------------------------------------
+    bool init()                                                                 //allocates, can be called more than once
+    {
+        try {
+            m_in.resize (lz4::block_max);
+            m_out.resize (lz4::compress_bound (lz4::block_max) + 4);
+            m_table.resize (1 << lz4::hash_log);
+        }
+        catch (...) {
+            return false;
+        }
+        return true;
+    }
+    //--------------------------------------------------------------------------
+    void free()
+    {
+        std::vector<u8>().swap (m_in);
+        std::vector<u8>().swap (m_out);
+        std::vector<u32>().swap (m_table);
+        m_in_size = 0;
+    }
+    //--------------------------------------------------------------------------
+    template <class sink>
+    void begin (sink& o)
+    {
+        u8 hdr[frame_header_size];
+        lz4::write_le32 (hdr, 0x184D2204);                                      //magic
+        hdr[4] = 0x60;                                                          //version 01, independent blocks
+        hdr[5] = 0x40;                                                          //64KB max block size
+        hdr[6] = (u8) (lz4::xxh32 (&hdr[4], 2, 0) >> 8);
+        o.write (hdr, sizeof hdr);
+        m_in_size = 0;
+    }
+    //--------------------------------------------------------------------------
+    template <class sink>
+    void write (sink& o, const void* data, uword sz)
+    {
+        assert (m_in.size());
+        const u8* src = (const u8*) data;
+        while (sz) {
+            uword cp = lz4::block_max - m_in_size;
+            cp       = (cp < sz) ? cp : sz;
+            std::memcpy (&m_in[m_in_size], src, cp);
+            m_in_size += cp;
+            src       += cp;
+            sz        -= cp;
+            if (m_in_size == lz4::block_max) {
+                write_block (o);
+            }
+        }
+    }
+    //--------------------------------------------------------------------------
+    template <class sink>
+    void flush (sink& o)                                                        //emits the partial block, if any
+    {
+        if (m_in_size) {
+            write_block (o);
+        }
+    }
+    //--------------------------------------------------------------------------
+    template <class sink>
+    void end (sink& o)
+    {
+        flush (o);
+        u8 end_mark[4] = { 0, 0, 0, 0 };
+        o.write (end_mark, sizeof end_mark);
+    }
+    //--------------------------------------------------------------------------
+private:
+    //--------------------------------------------------------------------------
+    template <class sink>
+    void write_block (sink& o)
+    {
+        uword sz = lz4::compress_block(
+            &m_out[4], &m_in[0], m_in_size, &m_table[0]
+            );
+        if (sz < m_in_size) {
+            lz4::write_le32 (&m_out[0], (u32) sz);
+        }
+        else {                                                                  //incompressible: stored
+            sz = m_in_size;
+            lz4::write_le32 (&m_out[0], (u32) sz | 0x80000000);
+            std::memcpy (&m_out[4], &m_in[0], sz);
+        }
+        o.write (&m_out[0], sz + 4);
+        m_in_size = 0;
+    }
+    //--------------------------------------------------------------------------
+    std::vector<u8>  m_in;
+    std::vector<u8>  m_out;
+    std::vector<u32> m_table;
+    uword            m_in_size;
+};
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_LZ4_FRAME_HPP_ */
@@ -110,6 +110,14 @@ public:
         return (void*) (m_mem + head_pos);
     }
     //--------------------------------------------------------------------------
+    void* at (uword idx)                                                        //0 = head
+    {
+        assert (idx < size());
+        uword pos = ((u8*) head() - m_mem) + (idx * m_entry_size);
+        pos       = (pos < m_total_size) ? pos : pos - m_total_size;
+        return (void*) (m_mem + pos);
+    }
+    //--------------------------------------------------------------------------
     void pop_head()
     {
         assert (!is_empty());
@@ -0,0 +1,230 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef MAL_LOG_STRING_SCAN_HPP_
+#define MAL_LOG_STRING_SCAN_HPP_
+
+#include <cassert>
+#include <mal_log/util/integer.hpp>
+#include <mal_log/util/cpu_features.hpp>
+
+#if defined (_MSC_VER)
+    #include <intrin.h>
+#endif
+
+// String scanning kernels for the consumer side: the NUL terminator (bounded
+// "strlen") and a character or NUL ("strchrnul").
+//
+// The SIMD versions do aligned loads, so they may read past the terminator
+// but never across a page boundary (same trick as the libc implementations).
+// This will be reported by memory checkers as a read of uninitialized bytes,
+// define MAL_NO_SIMD when running them.
+
+namespace mal {
+//------------------------------------------------------------------------------
+namespace detail {
+//------------------------------------------------------------------------------
+inline unsigned lsb_index (u32 v)
+{
+    assert (v);
+#if defined (_MSC_VER)
+    unsigned long idx;
+    _BitScanForward (&idx, v);
+    return (unsigned) idx;
+#else
+    return (unsigned) __builtin_ctz (v);
+#endif
+}
+//------------------------------------------------------------------------------
+inline uword find_nul_scalar (const char* s, uword max)
+{
+    uword i = 0;
+    while (i < max && s[i] != 0) {
+        ++i;
+    }
+    return i;
+}
+//------------------------------------------------------------------------------
+inline const char* find_chr_or_nul_scalar (const char* s, char c)
+{
+    while (*s != 0 && *s != c) {
+        ++s;
+    }
+    return s;
+}
+//------------------------------------------------------------------------------
+#if defined (MAL_HAS_SSE2)
+inline uword find_nul_sse2 (const char* s, uword max)
+{
+    const __m128i zero = _mm_setzero_si128();
+    uword misalign = ((uword) s) & 15;
+    const char* p  = s - misalign;
+    u32 mask = (u32) _mm_movemask_epi8(
+        _mm_cmpeq_epi8 (_mm_load_si128 ((const __m128i*) p), zero)
+        );
+    mask >>= misalign;
+    uword i = 0;
+    for (uword next = 16 - misalign; !mask; next += 16) {
+        if (next >= max) {
+            return max;
+        }
+        i    = next;
+        mask = (u32) _mm_movemask_epi8(
+            _mm_cmpeq_epi8 (_mm_load_si128 ((const __m128i*) (s + i)), zero)
+            );
+    }
+    i += lsb_index (mask);
+    return (i < max) ? i : max;
+}
+//------------------------------------------------------------------------------
+inline const char* find_chr_or_nul_sse2 (const char* s, char c)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i chr  = _mm_set1_epi8 (c);
+    uword misalign = ((uword) s) & 15;
+    const char* p  = s - misalign;
+    __m128i v      = _mm_load_si128 ((const __m128i*) p);
+    u32 mask       = (u32) _mm_movemask_epi8(
+        _mm_or_si128 (_mm_cmpeq_epi8 (v, zero), _mm_cmpeq_epi8 (v, chr))
+        );
+    mask >>= misalign;
+    if (mask) {
+        return s + lsb_index (mask);
+    }
+    p += 16;
+    while (true) {
+        v    = _mm_load_si128 ((const __m128i*) p);
+        mask = (u32) _mm_movemask_epi8(
+            _mm_or_si128 (_mm_cmpeq_epi8 (v, zero), _mm_cmpeq_epi8 (v, chr))
+            );
+        if (mask) {
+            return p + lsb_index (mask);
+        }
+        p += 16;
+    }
+}
+#endif
+//------------------------------------------------------------------------------
+#if defined (MAL_HAS_AVX2_DISPATCH)
+MAL_TARGET_AVX2 inline uword find_nul_avx2 (const char* s, uword max)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    uword misalign = ((uword) s) & 31;
+    const char* p  = s - misalign;
+    u32 mask = (u32) _mm256_movemask_epi8(
+        _mm256_cmpeq_epi8 (_mm256_load_si256 ((const __m256i*) p), zero)
+        );
+    mask = misalign ? (mask >> misalign) : mask;
+    uword i = 0;
+    for (uword next = 32 - misalign; !mask; next += 32) {
+        if (next >= max) {
+            return max;
+        }
+        i    = next;
+        mask = (u32) _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8 (_mm256_load_si256 ((const __m256i*) (s + i)), zero)
+            );
+    }
+    i += lsb_index (mask);
+    return (i < max) ? i : max;
+}
+//------------------------------------------------------------------------------
+MAL_TARGET_AVX2 inline const char* find_chr_or_nul_avx2 (const char* s, char c)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i chr  = _mm256_set1_epi8 (c);
+    uword misalign = ((uword) s) & 31;
+    const char* p  = s - misalign;
+    __m256i v      = _mm256_load_si256 ((const __m256i*) p);
+    u32 mask       = (u32) _mm256_movemask_epi8(
+        _mm256_or_si256 (_mm256_cmpeq_epi8 (v, zero), _mm256_cmpeq_epi8 (v, chr))
+        );
+    mask = misalign ? (mask >> misalign) : mask;
+    if (mask) {
+        return s + lsb_index (mask);
+    }
+    p += 32;
+    while (true) {
+        v    = _mm256_load_si256 ((const __m256i*) p);
+        mask = (u32) _mm256_movemask_epi8(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8 (v, zero), _mm256_cmpeq_epi8 (v, chr)
+                )
+            );
+        if (mask) {
+            return p + lsb_index (mask);
+        }
+        p += 32;
+    }
+}
+#endif
+//------------------------------------------------------------------------------
+} //namespace detail
+//------------------------------------------------------------------------------
+// Returns the NUL position or "max" if there is no NUL on the first "max"
+// chars.
+inline uword find_nul (const char* s, uword max)
+{
+#if defined (MAL_HAS_AVX2_DISPATCH)
+    if (cpu_has_avx2()) {
+        return detail::find_nul_avx2 (s, max);
+    }
+#endif
+#if defined (MAL_HAS_SSE2)
+    return detail::find_nul_sse2 (s, max);
+#else
+    return detail::find_nul_scalar (s, max);
+#endif
+}
+//------------------------------------------------------------------------------
+// Returns a pointer to the first "c" or to the NUL terminator.
+inline const char* find_chr_or_nul (const char* s, char c)
+{
+#if defined (MAL_HAS_AVX2_DISPATCH)
+    if (cpu_has_avx2()) {
+        return detail::find_chr_or_nul_avx2 (s, c);
+    }
+#endif
+#if defined (MAL_HAS_SSE2)
+    return detail::find_chr_or_nul_sse2 (s, c);
+#else
+    return detail::find_chr_or_nul_scalar (s, c);
+#endif
+}
+//------------------------------------------------------------------------------
+} //namespaces
+
+#endif /* MAL_LOG_STRING_SCAN_HPP_ */
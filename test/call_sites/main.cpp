@@ -0,0 +1,285 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+/* Checks the call site registry: rule precedence, rules applied to the lines
+   that didn't run yet, "reset_call_sites" and the "*"/"?" wildcards on both
+   "file:line" and the format string. Usage: mal-test-call-sites <out folder>
+*/
+
+#define MAL_CALL_SITE_REGISTRY
+
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+#include <mal_log/mal_log.hpp>
+#include <mal_log/frontend.hpp>
+#include <mal_log/call_site.hpp>
+
+#if defined (MAL_UNIX_LIKE)
+    #include <dirent.h>
+    #include <sys/stat.h>
+#endif
+
+//------------------------------------------------------------------------------
+mal::frontend& get_mal_logger_instance()
+{
+    static mal::frontend fe;
+    return fe;
+}
+//------------------------------------------------------------------------------
+#if defined (MAL_UNIX_LIKE)
+//------------------------------------------------------------------------------
+static void alpha (int step)
+{
+    log_error ("alpha retrying {}", step);
+}
+//------------------------------------------------------------------------------
+static const unsigned beta_line = __LINE__ + 3;
+static void beta (int step)
+{
+    log_error ("beta {}", step);
+}
+//------------------------------------------------------------------------------
+static void gamma_ (int step)
+{
+    log_error ("gamma on {}", step);
+}
+//------------------------------------------------------------------------------
+static const unsigned delta_line = __LINE__ + 3;
+static void delta (int step)
+{
+    log_error ("delta {}", step);
+}
+//------------------------------------------------------------------------------
+static void epsilon (int step)
+{
+    log_error ("epsilon retrying {}", step);
+}
+//------------------------------------------------------------------------------
+static void eta (int step)
+{
+    log_error ("eta retrying {}", step);
+}
+//------------------------------------------------------------------------------
+static void zeta (int step)
+{
+    log_error ("zeta {}", step);
+}
+//------------------------------------------------------------------------------
+static std::string line_pattern (const char* sep, unsigned line)
+{
+    char str[64];
+    std::snprintf (str, sizeof str, "*call_sites%smain.cpp:%u", sep, line);
+    return str;
+}
+//------------------------------------------------------------------------------
+static bool failed = false;
+//------------------------------------------------------------------------------
+static void check (bool ok, const char* what)
+{
+    if (!ok) {
+        std::fprintf (stderr, "failed: %s\n", what);
+        failed = true;
+    }
+}
+//------------------------------------------------------------------------------
+static bool site_enabled (const char* fmt)
+{
+    bool enabled = false;
+    mal::uword n = mal::for_each_call_site (fmt, [&](const mal::call_site& s) {
+        enabled = s.is_enabled();
+    });
+    return n == 1 && enabled;
+}
+//------------------------------------------------------------------------------
+static std::vector<std::string> list_files(
+    const std::string& folder, const std::string& prefix
+    )
+{
+    std::vector<std::string> files;
+    DIR* d = opendir (folder.c_str());
+    if (!d) {
+        return files;
+    }
+    while (dirent* e = readdir (d)) {
+        if (std::strncmp (e->d_name, prefix.c_str(), prefix.size()) == 0) {
+            files.push_back (folder + "/" + e->d_name);
+        }
+    }
+    closedir (d);
+    return files;
+}
+//------------------------------------------------------------------------------
+static std::set<std::string> read_messages (const std::string& file)
+{
+    std::set<std::string> msgs;
+    std::FILE* f = std::fopen (file.c_str(), "r");
+    if (!f) {
+        return msgs;
+    }
+    char line[256];
+    while (std::fgets (line, sizeof line, f)) {
+        const char* msg = std::strstr (line, "] ");
+        if (msg) {
+            std::string m (msg + 2);
+            if (!m.empty() && m[m.size() - 1] == '\n') {
+                m.erase (m.size() - 1);
+            }
+            msgs.insert (m);
+        }
+    }
+    std::fclose (f);
+    return msgs;
+}
+//------------------------------------------------------------------------------
+int main (int argc, const char* argv[])
+{
+    using mal::call_site_registry;
+    if (argc != 2) {
+        std::fprintf (stderr, "usage: %s <out folder>\n", argv[0]);
+        return 1;
+    }
+    std::string folder = argv[1];
+    std::string prefix = "call_sites.";
+    mkdir (folder.c_str(), 0755);
+    std::vector<std::string> files = list_files (folder, prefix);
+    for (auto it = files.begin(); it != files.end(); ++it) {
+        std::remove (it->c_str());
+    }
+
+    check (call_site_registry::wildcard_match ("a?c", "abc"), "? matches");
+    check (!call_site_registry::wildcard_match ("a?c", "ac"), "? needs one");
+    check (call_site_registry::wildcard_match ("*", ""), "* matches empty");
+    check (call_site_registry::wildcard_match ("a*b*c", "axxbyyc"), "* twice");
+    check (!call_site_registry::wildcard_match ("a*b", "axxbc"), "* anchored");
+
+    mal::frontend& fe = get_mal_logger_instance();
+    auto c             = fe.get_cfg();
+    c.file.out_folder  = folder + "/";
+    c.file.name_prefix = prefix;
+    c.file.aprox_size  = 0;                                                     //one file
+    if (fe.init_backend (c) != mal::frontend::init_ok) {
+        std::fprintf (stderr, "unable to initialize the logger\n");
+        return 1;
+    }
+    fe.set_file_severity (mal::sev::notice);
+    fe.set_console_severity (mal::sev::off);
+
+    /* 1: everything is enabled without rules */
+    alpha (1);
+    zeta (1);
+    /* 2: "*" on the format string, only "alpha" is registered */
+    check(
+        mal::set_call_sites_enabled ("*retrying*", false) == 1,
+        "a format string rule counts the registered matches"
+        );
+    alpha (2);
+    zeta (2);
+    /* 3: the last matching rule wins, setting a rule again moves it last */
+    mal::set_call_sites_enabled ("alpha*", true);
+    alpha (3);
+    mal::set_call_sites_enabled ("*retrying*", false);
+    alpha (4);
+    /* 5: rules on lines that didn't run yet, "file:line" and "?" */
+    check(
+        mal::set_call_sites_enabled(
+            line_pattern ("/", beta_line).c_str(), false
+            ) == 0,
+        "a rule on unregistered lines has no registered matches"
+        );
+    mal::set_call_sites_enabled ("eta*", true);                                 //overrides "*retrying*"
+    mal::set_call_sites_enabled ("gamma ?? {}", false);
+    mal::set_call_sites_enabled(
+        line_pattern ("?", delta_line).c_str(), false
+        );
+    beta (5);
+    gamma_ (5);
+    delta (5);
+    epsilon (5);
+    eta (5);
+    zeta (5);
+    check (!site_enabled ("beta {}"), "beta disabled before it ran");
+    check (!site_enabled ("epsilon*"), "epsilon disabled before it ran");
+    check (site_enabled ("zeta {}"), "zeta untouched");
+    /* 6: reset enables everything and drops the rules */
+    mal::reset_call_sites();
+    alpha (6);
+    beta (6);
+    gamma_ (6);
+    delta (6);
+    epsilon (6);
+    check (site_enabled ("alpha*"), "alpha enabled after the reset");
+    fe.on_termination();
+
+    files = list_files (folder, prefix);
+    if (files.size() != 1) {
+        std::fprintf (stderr, "expected one log file\n");
+        return 1;
+    }
+    std::set<std::string> msgs = read_messages (files[0]);
+    static const char* logged[] = {
+        "alpha retrying 1", "zeta 1", "zeta 2", "alpha retrying 3",
+        "eta retrying 5", "zeta 5", "alpha retrying 6", "beta 6", "gamma on 6",
+        "delta 6", "epsilon retrying 6",
+    };
+    static const char* filtered[] = {
+        "alpha retrying 2", "alpha retrying 4", "beta 5", "gamma on 5",
+        "delta 5", "epsilon retrying 5",
+    };
+    for (unsigned i = 0; i < sizeof logged / sizeof logged[0]; ++i) {
+        check (msgs.count (logged[i]) == 1, logged[i]);
+    }
+    for (unsigned i = 0; i < sizeof filtered / sizeof filtered[0]; ++i) {
+        check (msgs.count (filtered[i]) == 0, filtered[i]);
+    }
+    if (failed) {
+        return 1;
+    }
+    std::printf ("ok\n");
+    return 0;
+}
+//------------------------------------------------------------------------------
+#else
+//------------------------------------------------------------------------------
+int main (int, const char*[])
+{
+    std::printf ("skipped: no directory listing on this platform\n");
+    return 0;
+}
+//------------------------------------------------------------------------------
+#endif
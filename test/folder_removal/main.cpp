@@ -0,0 +1,168 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+/* Checks that the logger survives its output folder being removed while it is
+   logging and that it resumes writing files once the folder is back. Usage:
+   mal-test-folder-removal <out folder> */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <mal_log/mal_log.hpp>
+#include <mal_log/frontend.hpp>
+
+#if defined (MAL_UNIX_LIKE)
+    #include <dirent.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+//------------------------------------------------------------------------------
+mal::frontend& get_mal_logger_instance()
+{
+    static mal::frontend fe;
+    return fe;
+}
+//------------------------------------------------------------------------------
+#if defined (MAL_UNIX_LIKE)
+//------------------------------------------------------------------------------
+static const unsigned entries         = 2000;                                   //many slices
+static const unsigned removed_entries = 200;                                    //a few slices, each failing batch sleeps
+//------------------------------------------------------------------------------
+static std::vector<std::string> list_files (const std::string& folder)
+{
+    std::vector<std::string> files;
+    DIR* d = opendir (folder.c_str());
+    if (!d) {
+        return files;
+    }
+    while (dirent* e = readdir (d)) {
+        if (e->d_name[0] != '.') {
+            files.push_back (folder + "/" + e->d_name);
+        }
+    }
+    closedir (d);
+    return files;
+}
+//------------------------------------------------------------------------------
+static void remove_folder (const std::string& folder)
+{
+    std::vector<std::string> files = list_files (folder);
+    for (auto it = files.begin(); it != files.end(); ++it) {
+        std::remove (it->c_str());
+    }
+    rmdir (folder.c_str());
+}
+//------------------------------------------------------------------------------
+static bool folder_contains (const std::string& folder, const char* text)
+{
+    std::vector<std::string> files = list_files (folder);
+    for (auto it = files.begin(); it != files.end(); ++it) {
+        std::FILE* f = std::fopen (it->c_str(), "r");
+        if (!f) {
+            continue;
+        }
+        char line[256];
+        bool found = false;
+        while (!found && std::fgets (line, sizeof line, f)) {
+            found = std::strstr (line, text) != nullptr;
+        }
+        std::fclose (f);
+        if (found) {
+            return true;
+        }
+    }
+    return false;
+}
+//------------------------------------------------------------------------------
+int main (int argc, const char* argv[])
+{
+    if (argc != 2) {
+        std::fprintf (stderr, "usage: %s <out folder>\n", argv[0]);
+        return 1;
+    }
+    std::string parent = argv[1];
+    std::string folder = parent + "/folder_removal";
+    mkdir (parent.c_str(), 0755);
+    remove_folder (folder);
+    mkdir (folder.c_str(), 0755);
+
+    mal::frontend& fe = get_mal_logger_instance();
+    auto c             = fe.get_cfg();
+    c.file.out_folder  = folder + "/";
+    c.file.name_prefix = "folder_removal.";
+    c.file.aprox_size  = 4096;
+    if (fe.init_backend (c) != mal::frontend::init_ok) {
+        std::fprintf (stderr, "unable to initialize the logger\n");
+        return 1;
+    }
+    fe.set_file_severity (mal::sev::notice);
+    fe.set_console_severity (mal::sev::off);
+
+    for (unsigned i = 0; i < entries; ++i) {
+        log_error ("before the removal {}", i);
+    }
+    log_error_sync ("before the removal done");
+    remove_folder (folder);
+    for (unsigned i = 0; i < removed_entries; ++i) {                            //the next slices can't be opened
+        log_error ("while removed {}", i);
+    }
+    log_error_sync ("while removed done");
+    mkdir (folder.c_str(), 0755);
+    for (unsigned i = 0; i < entries; ++i) {
+        log_error ("after the removal {}", i);
+    }
+    log_error_sync ("after the removal done");
+    fe.on_termination();
+
+    if (!folder_contains (folder, "after the removal done")) {
+        std::fprintf (stderr, "the logger didn't resume writing files\n");
+        return 1;
+    }
+    std::printf ("ok\n");
+    return 0;
+}
+//------------------------------------------------------------------------------
+#else
+//------------------------------------------------------------------------------
+int main (int, const char*[])
+{
+    std::printf ("skipped: no directory removal on this platform\n");
+    return 0;
+}
+//------------------------------------------------------------------------------
+#endif
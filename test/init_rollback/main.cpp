@@ -0,0 +1,137 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+/* Checks that a failed initialization leaves no helper threads running and
+   that the initialization can be retried. The I/O thread initialization is
+   made to fail by requesting an impossible buffer count, after everything
+   else was set up. Usage: mal-test-init-rollback <out folder> */
+
+#include <cstdio>
+#include <string>
+#include <mal_log/mal_log.hpp>
+#include <mal_log/frontend.hpp>
+
+#if defined (MAL_UNIX_LIKE)
+    #include <dirent.h>
+    #include <sys/stat.h>
+#endif
+
+//------------------------------------------------------------------------------
+mal::frontend& get_mal_logger_instance()
+{
+    static mal::frontend fe;
+    return fe;
+}
+//------------------------------------------------------------------------------
+#if defined (__linux__)
+//------------------------------------------------------------------------------
+static int thread_count()
+{
+    int  count = 0;
+    DIR* d     = opendir ("/proc/self/task");
+    if (!d) {
+        return -1;
+    }
+    while (dirent* e = readdir (d)) {
+        if (e->d_name[0] != '.') {
+            ++count;
+        }
+    }
+    closedir (d);
+    return count;
+}
+//------------------------------------------------------------------------------
+int main (int argc, const char* argv[])
+{
+    if (argc != 2) {
+        std::fprintf (stderr, "usage: %s <out folder>\n", argv[0]);
+        return 1;
+    }
+    std::string folder = argv[1];
+    mkdir (folder.c_str(), 0755);
+
+    mal::frontend& fe = get_mal_logger_instance();
+    auto c             = fe.get_cfg();
+    c.file.out_folder  = folder + "/";
+    c.file.name_prefix = "init_rollback.";
+    c.file.aprox_size  = 64 * 1024;
+    c.file.compress_closed_slices = true;
+    c.file.preopen_pct            = 50;
+    c.tcp.host                    = "127.0.0.1";                                //nothing listening, it spills
+    c.tcp.port                    = "1";
+    c.formatting.workers          = 2;
+    c.console_queue.buffer_count  = 4;
+    c.io.dedicated_thread         = true;
+    c.io.buffer_count             = ((mal::uword) -1) / 2;                      //fails to allocate
+
+    int threads = thread_count();
+    if (fe.init_backend (c) != mal::frontend::init_tried_but_failed) {
+        std::fprintf (stderr, "the initialization didn't fail\n");
+        return 1;
+    }
+    if (thread_count() != threads) {
+        std::fprintf(
+            stderr,
+            "%d threads left running after a failed initialization\n",
+            thread_count() - threads
+            );
+        return 1;
+    }
+    c.io.buffer_count = 4;
+    if (fe.init_backend (c) != mal::frontend::init_ok) {
+        std::fprintf (stderr, "the initialization can't be retried\n");
+        return 1;
+    }
+    fe.set_console_severity (mal::sev::off);
+    bool ok = log_error ("init rollback check");
+    fe.on_termination();
+    if (!ok) {
+        std::fprintf (stderr, "unable to log after retrying\n");
+        return 1;
+    }
+    std::printf ("ok\n");
+    return 0;
+}
+//------------------------------------------------------------------------------
+#else
+//------------------------------------------------------------------------------
+int main (int, const char*[])
+{
+    std::printf ("skipped: no thread listing on this platform\n");
+    return 0;
+}
+//------------------------------------------------------------------------------
+#endif
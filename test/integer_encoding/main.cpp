@@ -0,0 +1,201 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+/* Checks that the fixed width integer encoding ("mal::fixed_width") and the
+   default one render the same text for the edge values of every integer type.
+   Usage: mal-test-integer-encoding <out folder> */
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include <mal_log/mal_log.hpp>
+#include <mal_log/frontend.hpp>
+
+#if defined (MAL_UNIX_LIKE)
+    #include <dirent.h>
+    #include <sys/stat.h>
+#endif
+
+//------------------------------------------------------------------------------
+mal::frontend& get_mal_logger_instance()
+{
+    static mal::frontend fe;
+    return fe;
+}
+//------------------------------------------------------------------------------
+#if defined (MAL_UNIX_LIKE)
+//------------------------------------------------------------------------------
+static const mal::u64 boundaries[] = {                                          //around every byte count change
+    0, 1, 2,
+    0x7fULL, 0x80ULL, 0xffULL, 0x100ULL,
+    0x7fffULL, 0x8000ULL, 0xffffULL, 0x10000ULL,
+    0x7fffffULL, 0x800000ULL, 0xffffffULL, 0x1000000ULL,
+    0x7fffffffULL, 0x80000000ULL, 0xffffffffULL, 0x100000000ULL,
+    0x7fffffffffULL, 0x8000000000ULL, 0xffffffffffULL,
+    0x7fffffffffffULL, 0x800000000000ULL, 0xffffffffffffULL,
+    0x7fffffffffffffULL, 0x80000000000000ULL, 0xffffffffffffffULL,
+    0x7fffffffffffffffULL, 0x8000000000000000ULL, 0xffffffffffffffffULL,
+};
+static const unsigned boundary_count = sizeof boundaries / sizeof boundaries[0];
+//------------------------------------------------------------------------------
+template <class T>
+static unsigned log_edges (const char* type)
+{
+    mal::frontend& fe = get_mal_logger_instance();
+    std::vector<T> v;
+    v.push_back (std::numeric_limits<T>::min());
+    v.push_back (std::numeric_limits<T>::max());
+    for (unsigned i = 0; i < boundary_count; ++i) {
+        v.push_back ((T) boundaries[i]);
+        v.push_back ((T) (0 - boundaries[i]));                                  //negative values on signed types
+    }
+    for (unsigned i = 0; i < v.size(); ++i) {
+        log_error_i(
+            mal::fixed_width (fe), "edge f {} {} {}", mal::lit (type), i, v[i]
+            );
+        log_error ("edge v {} {} {}", mal::lit (type), i, v[i]);
+    }
+    return (unsigned) v.size();
+}
+//------------------------------------------------------------------------------
+static std::vector<std::string> list_files(
+    const std::string& folder, const std::string& prefix
+    )
+{
+    std::vector<std::string> files;
+    DIR* d = opendir (folder.c_str());
+    if (!d) {
+        return files;
+    }
+    while (dirent* e = readdir (d)) {
+        if (std::strncmp (e->d_name, prefix.c_str(), prefix.size()) == 0) {
+            files.push_back (folder + "/" + e->d_name);
+        }
+    }
+    closedir (d);
+    return files;
+}
+//------------------------------------------------------------------------------
+int main (int argc, const char* argv[])
+{
+    if (argc != 2) {
+        std::fprintf (stderr, "usage: %s <out folder>\n", argv[0]);
+        return 1;
+    }
+    std::string folder = argv[1];
+    std::string prefix = "integer_encoding.";
+    mkdir (folder.c_str(), 0755);
+    std::vector<std::string> files = list_files (folder, prefix);
+    for (auto it = files.begin(); it != files.end(); ++it) {
+        std::remove (it->c_str());
+    }
+    mal::frontend& fe = get_mal_logger_instance();
+    auto c             = fe.get_cfg();
+    c.file.out_folder  = folder + "/";
+    c.file.name_prefix = prefix;
+    c.file.aprox_size  = 0;                                                     //one file
+    if (fe.init_backend (c) != mal::frontend::init_ok) {
+        std::fprintf (stderr, "unable to initialize the logger\n");
+        return 1;
+    }
+    fe.set_file_severity (mal::sev::notice);
+    fe.set_console_severity (mal::sev::off);
+    unsigned pairs = 0;
+    pairs += log_edges<mal::i8>  ("i8");
+    pairs += log_edges<mal::u8>  ("u8");
+    pairs += log_edges<mal::i16> ("i16");
+    pairs += log_edges<mal::u16> ("u16");
+    pairs += log_edges<mal::i32> ("i32");
+    pairs += log_edges<mal::u32> ("u32");
+    pairs += log_edges<mal::i64> ("i64");
+    pairs += log_edges<mal::u64> ("u64");
+    fe.on_termination();
+
+    files = list_files (folder, prefix);
+    if (files.size() != 1) {
+        std::fprintf (stderr, "expected one log file\n");
+        return 1;
+    }
+    std::FILE* f = std::fopen (files[0].c_str(), "r");
+    if (!f) {
+        std::fprintf (stderr, "unable to read %s\n", files[0].c_str());
+        return 1;
+    }
+    std::string fixed;
+    unsigned    found = 0;
+    bool        ok    = true;
+    char        line[512];
+    while (std::fgets (line, sizeof line, f)) {
+        const char* edge = std::strstr (line, "edge ");
+        if (!edge) {
+            continue;
+        }
+        if (edge[5] == 'f') {
+            fixed = edge + 7;
+            continue;
+        }
+        ++found;
+        if (fixed != edge + 7) {
+            std::fprintf(
+                stderr, "fixed: %s  default: %s", fixed.c_str(), edge + 7
+                );
+            ok = false;
+        }
+        fixed.clear();
+    }
+    std::fclose (f);
+    if (found != pairs) {
+        std::fprintf (stderr, "%u of %u entries found\n", found, pairs);
+        return 1;
+    }
+    if (!ok) {
+        return 1;
+    }
+    std::printf ("ok: %u values\n", pairs);
+    return 0;
+}
+//------------------------------------------------------------------------------
+#else
+//------------------------------------------------------------------------------
+int main (int, const char*[])
+{
+    std::printf ("skipped: no directory listing on this platform\n");
+    return 0;
+}
+//------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,214 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+/* Round trips "lz4_frame_writer" output through the reference "lz4" tool: the
+   frame has to pass "lz4 -t" and decompress to the original input. Usage:
+   mal-test-lz4-frame <out folder> <lz4 program> */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <mal_log/util/system.hpp>
+#include <mal_log/util/lz4_frame.hpp>
+
+#if defined (MAL_UNIX_LIKE)
+    #include <sys/stat.h>
+#endif
+
+//------------------------------------------------------------------------------
+struct file_sink
+{
+    std::FILE* f;
+    mal::uword bytes;
+    bool       ok;
+
+    void write (const void* data, mal::uword sz)
+    {
+        ok    &= std::fwrite (data, 1, sz, f) == sz;
+        bytes += sz;
+    }
+};
+//------------------------------------------------------------------------------
+static std::vector<mal::u8> compressible (mal::uword sz)
+{
+    std::vector<mal::u8> v;
+    char line[128];
+    for (unsigned i = 0; v.size() < sz; ++i) {
+        int len = std::snprintf(
+            line,
+            sizeof line,
+            "00000000000.%09u [note_] connection %u accepted from 10.0.0.%u\n",
+            i * 7919,
+            i,
+            i % 256
+            );
+        v.insert (v.end(), line, line + len);
+    }
+    v.resize (sz);
+    return v;
+}
+//------------------------------------------------------------------------------
+static std::vector<mal::u8> incompressible (mal::uword sz)
+{
+    std::vector<mal::u8> v (sz);
+    mal::u32 x = 2463534242U;                                                   //xorshift32
+    for (mal::uword i = 0; i < sz; ++i) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        v[i] = (mal::u8) x;
+    }
+    return v;
+}
+//------------------------------------------------------------------------------
+static bool read_file (const std::string& name, std::vector<mal::u8>& v)
+{
+    std::FILE* f = std::fopen (name.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    v.clear();
+    mal::u8 buff[4096];
+    mal::uword sz;
+    while ((sz = std::fread (buff, 1, sizeof buff, f)) != 0) {
+        v.insert (v.end(), buff, buff + sz);
+    }
+    std::fclose (f);
+    return true;
+}
+//------------------------------------------------------------------------------
+static bool round_trip(
+    const std::string&          folder,
+    const std::string&          lz4,
+    const char*                 name,
+    const std::vector<mal::u8>& in,
+    mal::uword                  write_size                                      //bytes passed on each "write" call
+    )
+{
+    std::string frame = folder + "/" + name + ".lz4";
+    std::string plain = folder + "/" + name;
+    file_sink s;
+    s.f     = std::fopen (frame.c_str(), "wb");
+    s.bytes = 0;
+    s.ok    = s.f != nullptr;
+    if (!s.ok) {
+        std::fprintf (stderr, "%s: unable to create %s\n", name, frame.c_str());
+        return false;
+    }
+    mal::lz4_frame_writer w;
+    if (!w.init()) {
+        std::fclose (s.f);
+        std::fprintf (stderr, "%s: unable to allocate\n", name);
+        return false;
+    }
+    w.begin (s);
+    for (mal::uword i = 0; i < in.size(); i += write_size) {
+        mal::uword sz = in.size() - i;
+        w.write (s, &in[i], sz < write_size ? sz : write_size);
+    }
+    w.end (s);
+    s.ok &= std::fclose (s.f) == 0;
+    if (!s.ok) {
+        std::fprintf (stderr, "%s: unable to write the frame\n", name);
+        return false;
+    }
+    std::string cmd = "\"" + lz4 + "\" -q -t \"" + frame + "\"";
+    if (std::system (cmd.c_str()) != 0) {
+        std::fprintf (stderr, "%s: rejected by \"lz4 -t\"\n", name);
+        return false;
+    }
+    cmd = "\"" + lz4 + "\" -q -d -f \"" + frame + "\" \"" + plain + "\"";
+    std::vector<mal::u8> out;
+    if (std::system (cmd.c_str()) != 0 || !read_file (plain, out)) {
+        std::fprintf (stderr, "%s: unable to decompress\n", name);
+        return false;
+    }
+    if (out != in) {
+        std::fprintf(
+            stderr,
+            "%s: decompressed %u bytes differ from the %u input bytes\n",
+            name,
+            (unsigned) out.size(),
+            (unsigned) in.size()
+            );
+        return false;
+    }
+    std::printf(
+        "%s: %u -> %u bytes\n",
+        name,
+        (unsigned) in.size(),
+        (unsigned) s.bytes
+        );
+    return true;
+}
+//------------------------------------------------------------------------------
+int main (int argc, const char* argv[])
+{
+    if (argc != 3) {
+        std::fprintf(
+            stderr, "usage: %s <out folder> <lz4 program>\n", argv[0]
+            );
+        return 1;
+    }
+    std::string folder = argv[1];
+    std::string lz4    = argv[2];
+#if defined (MAL_UNIX_LIKE)
+    mkdir (folder.c_str(), 0755);
+#endif
+    const mal::uword block = mal::lz4::block_max;
+    bool ok = true;
+    ok &= round_trip (folder, lz4, "lz4_empty", compressible (0), 1);
+    ok &= round_trip (folder, lz4, "lz4_text", compressible (300000), 4000);
+    ok &= round_trip(
+        folder, lz4, "lz4_random", incompressible (3 * block + 100), 4000
+        );
+    ok &= round_trip (folder, lz4, "lz4_text_block", compressible (block), 333);
+    ok &= round_trip(
+        folder, lz4, "lz4_random_block", incompressible (block), block
+        );
+    ok &= round_trip(
+        folder, lz4, "lz4_text_2_blocks", compressible (2 * block), block
+        );
+    ok &= round_trip(
+        folder, lz4, "lz4_text_block_plus_1", compressible (block + 1), 4000
+        );
+    if (!ok) {
+        return 1;
+    }
+    std::printf ("ok\n");
+    return 0;
+}
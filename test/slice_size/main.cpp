@@ -0,0 +1,163 @@
+/*
+The BSD 3-clause license
+--------------------------------------------------------------------------------
+Copyright (c) 2017 Rafael Gago Castano. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+   3. Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY RAFAEL GAGO CASTANO "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL RAFAEL GAGO CASTANO OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of Rafael Gago Castano.
+--------------------------------------------------------------------------------
+*/
+
+/* Checks that the file slices stay close to "file.aprox_size" when the entries
+   are written in batches. Usage: mal-test-slice-size <out folder> <mode>, mode
+   being "plain", "pipelined" (formatting threads) or "io" (I/O thread). */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <mal_log/mal_log.hpp>
+#include <mal_log/frontend.hpp>
+
+#if defined (MAL_UNIX_LIKE)
+    #include <dirent.h>
+    #include <sys/stat.h>
+#endif
+
+//------------------------------------------------------------------------------
+mal::frontend& get_mal_logger_instance()
+{
+    static mal::frontend fe;
+    return fe;
+}
+//------------------------------------------------------------------------------
+static const unsigned slice_bytes = 4096;
+static const unsigned max_entry   = 256;                                        //above the rendered size of the entries below
+static const unsigned entries     = 20000;
+//------------------------------------------------------------------------------
+#if defined (MAL_UNIX_LIKE)
+//------------------------------------------------------------------------------
+static std::vector<std::string> list_files(
+    const std::string& folder, const std::string& prefix
+    )
+{
+    std::vector<std::string> files;
+    DIR* d = opendir (folder.c_str());
+    if (!d) {
+        return files;
+    }
+    while (dirent* e = readdir (d)) {
+        if (std::strncmp (e->d_name, prefix.c_str(), prefix.size()) == 0) {
+            files.push_back (folder + "/" + e->d_name);
+        }
+    }
+    closedir (d);
+    return files;
+}
+//------------------------------------------------------------------------------
+static long file_size (const std::string& f)
+{
+    struct stat st;
+    return (stat (f.c_str(), &st) == 0) ? (long) st.st_size : -1;
+}
+//------------------------------------------------------------------------------
+int main (int argc, const char* argv[])
+{
+    if (argc != 3) {
+        std::fprintf (stderr, "usage: %s <out folder> <mode>\n", argv[0]);
+        return 1;
+    }
+    std::string folder = argv[1];
+    std::string mode   = argv[2];
+    std::string prefix = "slice_size." + mode + ".";
+    mkdir (folder.c_str(), 0755);
+    std::vector<std::string> old = list_files (folder, prefix);
+    for (auto it = old.begin(); it != old.end(); ++it) {
+        std::remove (it->c_str());
+    }
+    mal::frontend& fe = get_mal_logger_instance();
+    auto c             = fe.get_cfg();
+    c.file.out_folder  = folder + "/";
+    c.file.name_prefix = prefix;
+    c.file.aprox_size  = slice_bytes;
+    if (mode == "pipelined") {
+        c.formatting.workers = 2;
+    }
+    else if (mode == "io") {
+        c.io.dedicated_thread = true;
+    }
+    else if (mode != "plain") {
+        std::fprintf (stderr, "unknown mode: %s\n", mode.c_str());
+        return 1;
+    }
+    if (fe.init_backend (c) != mal::frontend::init_ok) {
+        std::fprintf (stderr, "unable to initialize the logger\n");
+        return 1;
+    }
+    fe.set_file_severity (mal::sev::notice);
+    fe.set_console_severity (mal::sev::off);
+    for (unsigned i = 0; i < entries; ++i) {
+        log_error ("slice size check entry {} of {}", i, entries);
+    }
+    fe.on_termination();
+
+    std::vector<std::string> files = list_files (folder, prefix);
+    long total = 0;
+    long max   = 0;
+    for (auto it = files.begin(); it != files.end(); ++it) {
+        long sz = file_size (*it);
+        total  += sz;
+        max     = (sz > max) ? sz : max;
+    }
+    std::printf(
+        "%s: %u slices, biggest %ld bytes\n",
+        mode.c_str(),
+        (unsigned) files.size(),
+        max
+        );
+    if (files.size() < 2 || total < (long) (entries * 30)) {
+        std::fprintf (stderr, "the entries weren't written\n");
+        return 1;
+    }
+    if (max > (long) (slice_bytes + max_entry)) {
+        std::fprintf (stderr, "slices exceed the configured size\n");
+        return 1;
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------
+#else
+//------------------------------------------------------------------------------
+int main (int, const char*[])
+{
+    std::printf ("skipped: no directory listing on this platform\n");
+    return 0;
+}
+//------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Prints the lines published by "mal::extras::shm_ring_sink" as they arrive.
+ *
+ * usage: mal_tail [-a] <ring file>
+ *   -a: start from the oldest line still in the ring instead of the newest.
+ *
+ * Waits for the ring to be created and reopens it when the writer recreates
+ * it. Lost data (the reader fell behind the writer) is reported on stderr.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <mal_log/util/thread.hpp>
+#include <mal_log/util/chrono.hpp>
+#include <mal_log/extras/shm_ring_reader.hpp>
+
+using namespace mal;
+
+//------------------------------------------------------------------------------
+int main (int argc, char* argv[])
+{
+    bool        from_oldest = false;
+    const char* path        = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp (argv[i], "-a") == 0) {
+            from_oldest = true;
+        }
+        else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        std::fprintf (stderr, "usage: mal_tail [-a] <ring file>\n");
+        return 1;
+    }
+    extras::shm_ring_reader r;
+    std::vector<char>       buf (256 * 1024);
+    u64                     lost = 0;
+    uword                   idle = 0;
+    while (true) {
+        if (!r.is_open()) {
+            if (!r.open (path, from_oldest)) {
+                from_oldest = true;                                             //everything on a new ring is new
+                th::this_thread::sleep_for (ch::milliseconds (100));
+                continue;
+            }
+            from_oldest = true;                                                 //on reopening nothing is skipped
+            lost        = 0;
+        }
+        uword size = r.read (&buf[0], buf.size());
+        if (r.lost() != lost) {
+            std::fprintf(
+                stderr,
+                "[mal_tail] %llu bytes lost\n",
+                (unsigned long long) (r.lost() - lost)
+                );
+            lost = r.lost();
+        }
+        if (size) {
+            std::fwrite (&buf[0], 1, size, stdout);
+            idle = 0;
+            continue;
+        }
+        std::fflush (stdout);
+        th::this_thread::sleep_for (ch::milliseconds (1));
+        if (++idle % 1000 == 0 && r.replaced (path)) {
+            r.close();
+        }
+    }
+    return 0;
+}